@@ -0,0 +1 @@
+SELECT bench_bulk_insert(100000);
@@ -0,0 +1 @@
+SELECT bench_bulk_insert(1000000);
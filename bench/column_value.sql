@@ -0,0 +1 @@
+SELECT bench_column_value(10000);
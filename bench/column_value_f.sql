@@ -0,0 +1 @@
+SELECT bench_column_value_f(10000);
@@ -0,0 +1 @@
+SELECT bench_describe_columns(1000);
@@ -0,0 +1 @@
+SELECT bench_fetch_array_narrow(1000);
@@ -0,0 +1 @@
+SELECT bench_fetch_array_wide(1000);
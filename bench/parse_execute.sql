@@ -0,0 +1 @@
+SELECT bench_parse_execute(1000);
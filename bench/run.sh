@@ -0,0 +1,60 @@
+#!/bin/sh
+#
+# Runs benchmarks of dbms_sql and reports throughput and the highest sampled
+# size of backend's memory. Used by "make bench".
+#
+# Environment variables:
+#   BENCH_DB      - database used for benchmarks (default dbms_sql_bench)
+#   BENCH_TIME    - duration of one benchmark in seconds (default 10)
+#   BENCH_CLIENTS - number of pgbench clients (default 1)
+#   PGBENCH, PSQL - used binaries (default from PATH)
+#
+# Memory is read from pg_backend_memory_contexts, so PostgreSQL 14 or
+# higher is required.
+
+set -e
+
+BENCH_DIR=$(dirname "$0")
+BENCH_DB=${BENCH_DB:-dbms_sql_bench}
+BENCH_TIME=${BENCH_TIME:-10}
+BENCH_CLIENTS=${BENCH_CLIENTS:-1}
+PGBENCH=${PGBENCH:-pgbench}
+PSQL=${PSQL:-psql}
+
+BENCHMARKS="bulk_insert_1k bulk_insert_100k bulk_insert_1m
+			fetch_array_narrow fetch_array_wide
+			column_value column_value_f
+			parse_execute describe_columns"
+
+if ! $PSQL -X -d "$BENCH_DB" -c "select 1" > /dev/null 2>&1; then
+	createdb "$BENCH_DB"
+fi
+
+$PSQL -X -q -v ON_ERROR_STOP=1 -d "$BENCH_DB" -f "$BENCH_DIR/setup.sql"
+
+printf "%-20s %12s %16s\n" "benchmark" "tps" "sampled memory"
+
+for bench in $BENCHMARKS
+do
+	# errors of pgbench are displayed, and the failed benchmark stops the run
+	if ! result=$($PGBENCH -n -T "$BENCH_TIME" -c "$BENCH_CLIENTS" \
+						   -f "$BENCH_DIR/$bench.sql" "$BENCH_DB"); then
+		echo "benchmark $bench failed" >&2
+		exit 1
+	fi
+
+	tps=$(echo "$result" | sed -n 's/^tps = \([0-9.]*\).*/\1/p' | tail -n 1)
+
+	# one more run in own session to sample memory inside loops of benchmark
+	if ! result=$($PSQL -X -q -At -v ON_ERROR_STOP=1 -d "$BENCH_DB" \
+						-c "set bench.sample_memory to on" \
+						-f "$BENCH_DIR/$bench.sql" \
+						-c "select pg_size_pretty(current_setting('bench.peak_memory')::bigint)"); then
+		echo "sampling of memory of benchmark $bench failed" >&2
+		exit 1
+	fi
+
+	memory=$(echo "$result" | tail -n 1)
+
+	printf "%-20s %12s %16s\n" "$bench" "$tps" "$memory"
+done
@@ -0,0 +1,244 @@
+-- Objects used by benchmarks of dbms_sql. The script is executed
+-- by bench/run.sh before benchmarks.
+
+set client_min_messages TO error;
+
+CREATE EXTENSION IF NOT EXISTS dbms_sql;
+
+DROP TABLE IF EXISTS bench_target;
+CREATE TABLE bench_target(a int, b text, c numeric);
+
+DROP TABLE IF EXISTS bench_narrow;
+CREATE TABLE bench_narrow AS SELECT i AS a FROM generate_series(1, 100000) g(i);
+
+DROP TABLE IF EXISTS bench_wide;
+CREATE TABLE bench_wide AS
+  SELECT i AS a, repeat('x', 100) || i AS b, repeat('y', 200) || i AS c,
+         i + 0.5 AS d, now() AS e, md5(i::text) AS f
+    FROM generate_series(1, 100000) g(i);
+
+CREATE INDEX ON bench_narrow(a);
+
+ANALYZE bench_narrow;
+ANALYZE bench_wide;
+
+/*
+ * Sets bench.peak_memory to size of all memory contexts of backend,
+ * when it is higher than current value. The memory is sampled only when
+ * bench.sample_memory is on (it is not set by runs measuring throughput),
+ * and it is sampled inside loops of benchmarks every 100 iterations.
+ */
+CREATE OR REPLACE FUNCTION bench_note_memory(iteration int DEFAULT 0)
+RETURNS void AS $$
+DECLARE
+  m bigint;
+BEGIN
+  IF iteration % 100 <> 0 OR
+     coalesce(current_setting('bench.sample_memory', true), '') <> 'on' THEN
+    RETURN;
+  END IF;
+
+  SELECT sum(total_bytes) INTO m FROM pg_backend_memory_contexts;
+  IF m > coalesce(nullif(current_setting('bench.peak_memory', true), '')::bigint, 0) THEN
+    PERFORM set_config('bench.peak_memory', m::text, false);
+  END IF;
+END;
+$$ LANGUAGE plpgsql;
+
+-- bulk insert by bind_array
+CREATE OR REPLACE FUNCTION bench_bulk_insert(nrows int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  a int[];
+  b text[];
+  n numeric[];
+BEGIN
+  a := array(SELECT i FROM generate_series(1, nrows) g(i));
+  b := array(SELECT 'Ahoj ' || i FROM generate_series(1, nrows) g(i));
+  n := array(SELECT i + 0.5 FROM generate_series(1, nrows) g(i));
+
+  c := dbms_sql.open_cursor();
+  CALL dbms_sql.parse(c, 'insert into bench_target values(:a, :b, :c)');
+  CALL dbms_sql.bind_array(c, 'a', a);
+  CALL dbms_sql.bind_array(c, 'b', b);
+  CALL dbms_sql.bind_array(c, 'c', n);
+  PERFORM dbms_sql.execute(c);
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+
+  TRUNCATE bench_target;
+END;
+$$ LANGUAGE plpgsql;
+
+-- fetch by define_array over narrow rows
+CREATE OR REPLACE FUNCTION bench_fetch_array_narrow(batch int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  a int[];
+  sample bool := current_setting('bench.sample_memory', true) = 'on';
+  j int := 0;
+BEGIN
+  c := dbms_sql.open_cursor();
+  CALL dbms_sql.parse(c, 'select a from bench_narrow');
+  CALL dbms_sql.define_array(c, 1, a, batch, 1);
+  PERFORM dbms_sql.execute(c);
+  WHILE dbms_sql.fetch_rows(c) > 0
+  LOOP
+    CALL dbms_sql.column_value(c, 1, a);
+    IF sample THEN
+      j := j + 1;
+      PERFORM bench_note_memory(j);
+    END IF;
+  END LOOP;
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+END;
+$$ LANGUAGE plpgsql;
+
+-- fetch by define_array over wide rows
+CREATE OR REPLACE FUNCTION bench_fetch_array_wide(batch int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  a int[];
+  b text[];
+  t text[];
+  d numeric[];
+  e timestamptz[];
+  f text[];
+  sample bool := current_setting('bench.sample_memory', true) = 'on';
+  j int := 0;
+BEGIN
+  c := dbms_sql.open_cursor();
+  CALL dbms_sql.parse(c, 'select a, b, c, d, e, f from bench_wide');
+  CALL dbms_sql.define_array(c, 1, a, batch, 1);
+  CALL dbms_sql.define_array(c, 2, b, batch, 1);
+  CALL dbms_sql.define_array(c, 3, t, batch, 1);
+  CALL dbms_sql.define_array(c, 4, d, batch, 1);
+  CALL dbms_sql.define_array(c, 5, e, batch, 1);
+  CALL dbms_sql.define_array(c, 6, f, batch, 1);
+  PERFORM dbms_sql.execute(c);
+  WHILE dbms_sql.fetch_rows(c) > 0
+  LOOP
+    CALL dbms_sql.column_value(c, 1, a);
+    CALL dbms_sql.column_value(c, 2, b);
+    CALL dbms_sql.column_value(c, 3, t);
+    CALL dbms_sql.column_value(c, 4, d);
+    CALL dbms_sql.column_value(c, 5, e);
+    CALL dbms_sql.column_value(c, 6, f);
+    IF sample THEN
+      j := j + 1;
+      PERFORM bench_note_memory(j);
+    END IF;
+  END LOOP;
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+END;
+$$ LANGUAGE plpgsql;
+
+-- scalar column_value procedure
+CREATE OR REPLACE FUNCTION bench_column_value(nrows int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  a int;
+  b text;
+  sample bool := current_setting('bench.sample_memory', true) = 'on';
+  j int := 0;
+BEGIN
+  c := dbms_sql.open_cursor();
+  CALL dbms_sql.parse(c, 'select a, b from bench_wide limit :n');
+  CALL dbms_sql.bind_variable(c, 'n', nrows);
+  CALL dbms_sql.define_column(c, 1, a);
+  CALL dbms_sql.define_column(c, 2, b);
+  PERFORM dbms_sql.execute(c);
+  WHILE dbms_sql.fetch_rows(c) > 0
+  LOOP
+    CALL dbms_sql.column_value(c, 1, a);
+    CALL dbms_sql.column_value(c, 2, b);
+    IF sample THEN
+      j := j + 1;
+      PERFORM bench_note_memory(j);
+    END IF;
+  END LOOP;
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+END;
+$$ LANGUAGE plpgsql;
+
+-- scalar column_value_f function
+CREATE OR REPLACE FUNCTION bench_column_value_f(nrows int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  a int;
+  b text;
+  sample bool := current_setting('bench.sample_memory', true) = 'on';
+  j int := 0;
+BEGIN
+  c := dbms_sql.open_cursor();
+  CALL dbms_sql.parse(c, 'select a, b from bench_wide limit :n');
+  CALL dbms_sql.bind_variable(c, 'n', nrows);
+  CALL dbms_sql.define_column(c, 1, a);
+  CALL dbms_sql.define_column(c, 2, b);
+  PERFORM dbms_sql.execute(c);
+  WHILE dbms_sql.fetch_rows(c) > 0
+  LOOP
+    a := dbms_sql.column_value_f(c, 1, a);
+    b := dbms_sql.column_value_f(c, 2, b);
+    IF sample THEN
+      j := j + 1;
+      PERFORM bench_note_memory(j);
+    END IF;
+  END LOOP;
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+END;
+$$ LANGUAGE plpgsql;
+
+-- repeated parse and execute of short statement
+CREATE OR REPLACE FUNCTION bench_parse_execute(loops int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  sample bool := current_setting('bench.sample_memory', true) = 'on';
+BEGIN
+  c := dbms_sql.open_cursor();
+  FOR i IN 1..loops
+  LOOP
+    CALL dbms_sql.parse(c, 'select a from bench_narrow where a = :a');
+    CALL dbms_sql.bind_variable(c, 'a', i);
+    PERFORM dbms_sql.execute(c);
+    IF sample THEN
+      PERFORM bench_note_memory(i);
+    END IF;
+  END LOOP;
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+END;
+$$ LANGUAGE plpgsql;
+
+-- repeated describe_columns of parsed query
+CREATE OR REPLACE FUNCTION bench_describe_columns(loops int)
+RETURNS void AS $$
+DECLARE
+  c int;
+  n int;
+  d dbms_sql.desc_rec[];
+  sample bool := current_setting('bench.sample_memory', true) = 'on';
+BEGIN
+  c := dbms_sql.open_cursor();
+  CALL dbms_sql.parse(c, 'select * from bench_wide');
+  FOR i IN 1..loops
+  LOOP
+    CALL dbms_sql.describe_columns(c, n, d);
+    IF sample THEN
+      PERFORM bench_note_memory(i);
+    END IF;
+  END LOOP;
+  PERFORM bench_note_memory();
+  CALL dbms_sql.close_cursor(c);
+END;
+$$ LANGUAGE plpgsql;
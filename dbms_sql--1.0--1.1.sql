@@ -0,0 +1,44 @@
+/* dbms_sql--1.0--1.1.sql */
+
+-- complain if script is sourced in psql, rather than via ALTER EXTENSION
+\echo Use "ALTER EXTENSION dbms_sql UPDATE TO '1.1'" to load this file. \quit
+
+CREATE FUNCTION dbms_sql.explain(c int, "analyze" bool DEFAULT false) RETURNS SETOF text AS 'MODULE_PATHNAME', 'dbms_sql_explain' LANGUAGE c;
+
+-- define_array has new argument accumulate
+DROP PROCEDURE dbms_sql.define_array(int, int, anyarray, int, int);
+CREATE PROCEDURE dbms_sql.define_array(c int, col int, value "anyarray", cnt int, lower_bnd int, accumulate bool DEFAULT false) AS 'MODULE_PATHNAME', 'dbms_sql_define_array' LANGUAGE c;
+
+CREATE FUNCTION dbms_sql.fetch_all(c int) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_fetch_all' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_prefetch_rows(c int, rows int) AS 'MODULE_PATHNAME', 'dbms_sql_set_prefetch_rows' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_parallel(c int, enabled bool) AS 'MODULE_PATHNAME', 'dbms_sql_set_parallel' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_holdable(c int, enabled bool) AS 'MODULE_PATHNAME', 'dbms_sql_set_holdable' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_direct_load(c int, enabled bool) AS 'MODULE_PATHNAME', 'dbms_sql_set_direct_load' LANGUAGE c;
+CREATE FUNCTION dbms_sql.to_refcursor(c int) RETURNS refcursor AS 'MODULE_PATHNAME', 'dbms_sql_to_refcursor' LANGUAGE c;
+CREATE FUNCTION dbms_sql.to_cursor_number(rc refcursor) RETURNS int AS 'MODULE_PATHNAME', 'dbms_sql_to_cursor_number' LANGUAGE c;
+CREATE FUNCTION dbms_sql.column_value_f_support(internal) RETURNS internal AS 'MODULE_PATHNAME', 'dbms_sql_column_value_f_support' LANGUAGE c;
+
+-- the accumulated array can be modified in place by PLpgSQL since PostgreSQL 18
+DO $$
+BEGIN
+  IF current_setting('server_version_num')::int >= 180000 THEN
+    ALTER FUNCTION dbms_sql.column_value_f(int, int, anyelement) SUPPORT dbms_sql.column_value_f_support;
+  END IF;
+END;
+$$;
+
+CREATE FUNCTION dbms_sql.column_values(c int) RETURNS record AS 'MODULE_PATHNAME', 'dbms_sql_column_values' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.variable_value(c int, name varchar2, INOUT value anyelement) AS 'MODULE_PATHNAME', 'dbms_sql_variable_value' LANGUAGE c;
+CREATE FUNCTION dbms_sql.variable_value_f(c int, name varchar2, value anyelement) RETURNS anyelement AS 'MODULE_PATHNAME', 'dbms_sql_variable_value_f' LANGUAGE c;
+
+CREATE FUNCTION dbms_sql.plan_cache_stats(OUT hits bigint, OUT misses bigint, OUT cached_plans int) AS 'MODULE_PATHNAME', 'dbms_sql_plan_cache_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.cursor_stats(OUT cursor_id int, OUT parse_calls bigint, OUT parse_time float8, OUT plan_hits bigint, OUT plan_misses bigint, OUT execute_calls bigint, OUT execute_time float8, OUT rows_processed bigint, OUT fetch_calls bigint, OUT fetched_rows bigint, OUT fetched_bytes bigint, OUT cast_misses bigint, OUT query text) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_cursor_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.session_stats(OUT parse_calls bigint, OUT parse_time float8, OUT plan_hits bigint, OUT plan_misses bigint, OUT execute_calls bigint, OUT execute_time float8, OUT rows_processed bigint, OUT fetch_calls bigint, OUT fetched_rows bigint, OUT fetched_bytes bigint, OUT cast_misses bigint) AS 'MODULE_PATHNAME', 'dbms_sql_session_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.memory_usage(OUT cursor_id int, OUT context text, OUT bytes bigint) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_memory_usage' LANGUAGE c;
+
+CREATE FUNCTION dbms_sql.statement_stats(OUT userid oid, OUT dbid oid, OUT queryid bigint, OUT calls bigint, OUT total_exec_time float8, OUT max_exec_time float8, OUT rows_processed bigint, OUT fetch_calls bigint, OUT total_fetch_time float8, OUT max_fetch_time float8, OUT fetched_rows bigint, OUT bind_array_rows bigint, OUT max_bind_array_size bigint, OUT query text) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_statement_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.statements_reset() RETURNS void AS 'MODULE_PATHNAME', 'dbms_sql_statements_reset' LANGUAGE c;
+
+CREATE VIEW dbms_sql.statements AS SELECT * FROM dbms_sql.statement_stats();
+
+REVOKE ALL ON FUNCTION dbms_sql.statements_reset() FROM PUBLIC;
@@ -0,0 +1,80 @@
+/* dbms_sql.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION dbms_sql" to load this file. \quit
+CREATE SCHEMA dbms_sql;
+
+/*
+ * temp solution, at the end varchar2 from orafce will be used
+ */
+CREATE DOMAIN varchar2 AS text; -- should be removed, if you use Orafce
+
+CREATE FUNCTION dbms_sql.is_open(c int) RETURNS bool AS 'MODULE_PATHNAME', 'dbms_sql_is_open' LANGUAGE c;
+CREATE FUNCTION dbms_sql.open_cursor() RETURNS int AS 'MODULE_PATHNAME', 'dbms_sql_open_cursor' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.close_cursor(c int) AS 'MODULE_PATHNAME', 'dbms_sql_close_cursor' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.debug_cursor(c int) AS 'MODULE_PATHNAME', 'dbms_sql_debug_cursor' LANGUAGE c;
+CREATE FUNCTION dbms_sql.explain(c int, "analyze" bool DEFAULT false) RETURNS SETOF text AS 'MODULE_PATHNAME', 'dbms_sql_explain' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.parse(c int, stmt varchar2) AS 'MODULE_PATHNAME', 'dbms_sql_parse' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.bind_variable(c int, name varchar2, value "any") AS 'MODULE_PATHNAME', 'dbms_sql_bind_variable' LANGUAGE c;
+CREATE FUNCTION dbms_sql.bind_variable_f(c int, name varchar2, value "any") RETURNS void AS 'MODULE_PATHNAME', 'dbms_sql_bind_variable_f' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.bind_array(c int, name varchar2, value anyarray) AS 'MODULE_PATHNAME', 'dbms_sql_bind_array_3' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.bind_array(c int, name varchar2, value anyarray, index1 int, index2 int) AS 'MODULE_PATHNAME', 'dbms_sql_bind_array_5' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.define_column(c int, col int, value "any", column_size int DEFAULT -1) AS 'MODULE_PATHNAME', 'dbms_sql_define_column' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.define_array(c int, col int, value "anyarray", cnt int, lower_bnd int, accumulate bool DEFAULT false) AS 'MODULE_PATHNAME', 'dbms_sql_define_array' LANGUAGE c;
+CREATE FUNCTION dbms_sql.execute(c int) RETURNS bigint AS 'MODULE_PATHNAME', 'dbms_sql_execute' LANGUAGE c;
+CREATE FUNCTION dbms_sql.fetch_rows(c int) RETURNS int AS 'MODULE_PATHNAME', 'dbms_sql_fetch_rows' LANGUAGE c;
+CREATE FUNCTION dbms_sql.execute_and_fetch(c int, exact bool DEFAULT false) RETURNS int AS 'MODULE_PATHNAME', 'dbms_sql_execute_and_fetch' LANGUAGE c;
+CREATE FUNCTION dbms_sql.fetch_all(c int) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_fetch_all' LANGUAGE c;
+CREATE FUNCTION dbms_sql.last_row_count() RETURNS int AS 'MODULE_PATHNAME', 'dbms_sql_last_row_count' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_prefetch_rows(c int, rows int) AS 'MODULE_PATHNAME', 'dbms_sql_set_prefetch_rows' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_parallel(c int, enabled bool) AS 'MODULE_PATHNAME', 'dbms_sql_set_parallel' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_holdable(c int, enabled bool) AS 'MODULE_PATHNAME', 'dbms_sql_set_holdable' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.set_direct_load(c int, enabled bool) AS 'MODULE_PATHNAME', 'dbms_sql_set_direct_load' LANGUAGE c;
+CREATE FUNCTION dbms_sql.to_refcursor(c int) RETURNS refcursor AS 'MODULE_PATHNAME', 'dbms_sql_to_refcursor' LANGUAGE c;
+CREATE FUNCTION dbms_sql.to_cursor_number(rc refcursor) RETURNS int AS 'MODULE_PATHNAME', 'dbms_sql_to_cursor_number' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.column_value(c int, pos int, INOUT value anyelement) AS 'MODULE_PATHNAME', 'dbms_sql_column_value' LANGUAGE c;
+CREATE FUNCTION dbms_sql.column_value_f(c int, pos int, value anyelement) RETURNS anyelement AS 'MODULE_PATHNAME', 'dbms_sql_column_value_f' LANGUAGE c;
+CREATE FUNCTION dbms_sql.column_value_f_support(internal) RETURNS internal AS 'MODULE_PATHNAME', 'dbms_sql_column_value_f_support' LANGUAGE c;
+
+-- the accumulated array can be modified in place by PLpgSQL since PostgreSQL 18
+DO $$
+BEGIN
+  IF current_setting('server_version_num')::int >= 180000 THEN
+    ALTER FUNCTION dbms_sql.column_value_f(int, int, anyelement) SUPPORT dbms_sql.column_value_f_support;
+  END IF;
+END;
+$$;
+
+CREATE FUNCTION dbms_sql.column_values(c int) RETURNS record AS 'MODULE_PATHNAME', 'dbms_sql_column_values' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.variable_value(c int, name varchar2, INOUT value anyelement) AS 'MODULE_PATHNAME', 'dbms_sql_variable_value' LANGUAGE c;
+CREATE FUNCTION dbms_sql.variable_value_f(c int, name varchar2, value anyelement) RETURNS anyelement AS 'MODULE_PATHNAME', 'dbms_sql_variable_value_f' LANGUAGE c;
+
+CREATE TYPE dbms_sql.desc_rec AS (
+    col_type int,
+    col_max_len int,
+    col_name text,
+    col_name_len int,
+    col_schema text,
+    col_schema_len int,
+    col_precision int,
+    col_scale int,
+    col_charsetid int,
+    col_charsetform int,
+    col_null_ok boolean,
+    col_type_name text,
+    col_type_name_len int);
+
+CREATE FUNCTION dbms_sql.describe_columns_f(c int, OUT col_cnt int, OUT desc_t dbms_sql.desc_rec[]) AS 'MODULE_PATHNAME', 'dbms_sql_describe_columns_f' LANGUAGE c;
+CREATE PROCEDURE dbms_sql.describe_columns(c int, INOUT col_cnt int, INOUT desc_t dbms_sql.desc_rec[]) AS 'MODULE_PATHNAME', 'dbms_sql_describe_columns_f' LANGUAGE c;
+
+CREATE FUNCTION dbms_sql.plan_cache_stats(OUT hits bigint, OUT misses bigint, OUT cached_plans int) AS 'MODULE_PATHNAME', 'dbms_sql_plan_cache_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.cursor_stats(OUT cursor_id int, OUT parse_calls bigint, OUT parse_time float8, OUT plan_hits bigint, OUT plan_misses bigint, OUT execute_calls bigint, OUT execute_time float8, OUT rows_processed bigint, OUT fetch_calls bigint, OUT fetched_rows bigint, OUT fetched_bytes bigint, OUT cast_misses bigint, OUT query text) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_cursor_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.session_stats(OUT parse_calls bigint, OUT parse_time float8, OUT plan_hits bigint, OUT plan_misses bigint, OUT execute_calls bigint, OUT execute_time float8, OUT rows_processed bigint, OUT fetch_calls bigint, OUT fetched_rows bigint, OUT fetched_bytes bigint, OUT cast_misses bigint) AS 'MODULE_PATHNAME', 'dbms_sql_session_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.memory_usage(OUT cursor_id int, OUT context text, OUT bytes bigint) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_memory_usage' LANGUAGE c;
+
+CREATE FUNCTION dbms_sql.statement_stats(OUT userid oid, OUT dbid oid, OUT queryid bigint, OUT calls bigint, OUT total_exec_time float8, OUT max_exec_time float8, OUT rows_processed bigint, OUT fetch_calls bigint, OUT total_fetch_time float8, OUT max_fetch_time float8, OUT fetched_rows bigint, OUT bind_array_rows bigint, OUT max_bind_array_size bigint, OUT query text) RETURNS SETOF record AS 'MODULE_PATHNAME', 'dbms_sql_statement_stats' LANGUAGE c;
+CREATE FUNCTION dbms_sql.statements_reset() RETURNS void AS 'MODULE_PATHNAME', 'dbms_sql_statements_reset' LANGUAGE c;
+
+CREATE VIEW dbms_sql.statements AS SELECT * FROM dbms_sql.statement_stats();
+
+REVOKE ALL ON FUNCTION dbms_sql.statements_reset() FROM PUBLIC;
@@ -9,26 +9,76 @@
 #endif
 
 #include "access/tupconvert.h"
+#include "access/xact.h"
+#include "catalog/pg_authid.h"
 #include "catalog/pg_type_d.h"
 #include "catalog/pg_type.h"
 #include "executor/spi.h"
+#include "lib/ilist.h"
 #include "lib/stringinfo.h"
+#include "mb/pg_wchar.h"
+#include "miscadmin.h"
 #include "nodes/pg_list.h"
 #include "parser/parse_coerce.h"
+#include "portability/instr_time.h"
 #include "parser/scansup.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "utils/acl.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/elog.h"
+#include "utils/expandeddatum.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 #include "utils/memutils.h"
+#include "utils/plancache.h"
+#include "utils/resowner.h"
 #include "utils/typcache.h"
 #include "executor/spi_priv.h"
 
-PG_MODULE_MAGIC;
+#if PG_VERSION_NUM >= 130000
+
+#include "common/hashfn.h"
+
+#elif PG_VERSION_NUM >= 120000
+
+#include "utils/hashutils.h"
+
+#else
+
+#include "access/hash.h"
+
+#endif
+
+#if PG_VERSION_NUM >= 140000
+
+#include "access/heapam.h"
+#include "access/table.h"
+#include "access/tableam.h"
+#include "catalog/namespace.h"
+#include "executor/executor.h"
+#include "utils/numeric.h"
+#include "utils/rel.h"
+#include "utils/rls.h"
+#include "utils/snapmgr.h"
+
+#endif
+
+#if PG_VERSION_NUM >= 180000
+
+#include "nodes/primnodes.h"
+#include "nodes/supportnodes.h"
+
+#endif
 
-#define MAX_CURSORS			100
+PG_MODULE_MAGIC;
 
 /*
  * bind variable data
@@ -52,6 +102,9 @@ typedef struct
 	int16		typelemlen;
 	int			index1;
 	int			index2;
+	Datum	   *elems;		/* element cache of bound array */
+	bool	   *elemnulls;	/* can be NULL, when there are not NULLs */
+	int			nelems;
 } VariableData;
 
 /*
@@ -69,57 +122,247 @@ typedef struct
 	Oid			typarrayoid;		/* oid of requested array output value */
 	int			rowcount;			/* maximal rows of requested array */
 	int			index1;				/* output array should be rewrited from this index */
+	bool		accumulate;			/* batches are appended to target array */
+	int			next_index;			/* index of next accumulated row */
 } ColumnData;
 
+typedef struct
+{
+	Oid			sourcetypid;
+	Oid			targettypid;
+	int32		targettypmod;
+	bool		isexplicit;		/* false for assignment (like INSERT) */
+} CastCacheKey;
+
+/*
+ * Specialized casts between common types. They are used instead of
+ * generic call of cast function or of IO cast.
+ */
+typedef enum
+{
+	CAST_KERNEL_GENERIC,			/* by coercion path */
+	CAST_KERNEL_INT2_INT4,
+	CAST_KERNEL_INT2_INT8,
+	CAST_KERNEL_INT4_INT2,
+	CAST_KERNEL_INT4_INT8,
+	CAST_KERNEL_INT8_INT2,
+	CAST_KERNEL_INT8_INT4,
+	CAST_KERNEL_INT2_FLOAT8,
+	CAST_KERNEL_INT4_FLOAT8,
+	CAST_KERNEL_INT8_FLOAT8,
+	CAST_KERNEL_FLOAT4_FLOAT8,
+	CAST_KERNEL_INT_NUMERIC,		/* int2, int4 or int8 to numeric */
+	CAST_KERNEL_OUT_TEXT,			/* output function result is text */
+	CAST_KERNEL_TEXT_IN				/* source is text, only input function is used */
+} CastKernel;
+
 /*
  * It is used for transformation result data to form
  * generated by column_value procedure or column
- * value function.
+ * value function. The entries are shared by all cursors,
+ * and they are never removed, only invalidated.
  */
 typedef struct
 {
+	CastCacheKey key;				/* hash key, should be first */
 	bool		isvalid;			/* true, when this cast can be used */
 	bool		without_cast;		/* true, when cast is not necessary */
 	Oid		targettypid;			/* used for domains */
-	Oid		array_targettypid;		/* used for array domains */
 	int32	targettypmod;			/* used for strings */
-	bool	typbyval;				/* used for copy result to outer memory context */
-	int16	typlen;					/* used for copy result to outer memory context */
-	bool	is_array;
+	Oid		basetypid;				/* base type of target type */
+	Oid		array_basetypid;		/* array of base type of target type */
+	int16	typlen;					/* attributes of base type of target type */
+	bool	typbyval;
+	char	typalign;
 
-	Oid		funcoid;
-	Oid		funcoid_typmod;
 	CoercionPathType path;
 	CoercionPathType path_typmod;
+	CastKernel	kernel;				/* specialized cast, or generic */
 	FmgrInfo	finfo;
 	FmgrInfo	finfo_typmod;
 	FmgrInfo	finfo_out;
 	FmgrInfo	finfo_in;
 	Oid			typIOParam;
+	MemoryContext fn_cxt;			/* memory of functions, reset by init */
+	uint32		type_hashes[3];		/* hashes of source, target and base type */
+	uint32		func_hashes[4];		/* hashes of used functions */
+} CastCacheEntry;
+
+/*
+ * Cast of one result column of cursor
+ */
+typedef struct
+{
+	bool		isvalid;			/* true, when this cast can be used */
+	CastCacheEntry *cast;
+	Oid		array_targettypid;		/* used for array domains */
+	bool	typbyval;				/* used for copy result to outer memory context */
+	int16	typlen;					/* used for copy result to outer memory context */
+	bool	is_array;
 } CastCacheData;
 
+/*
+ * Position of VALUES clause of simple INSERT INTO ... VALUES (...)
+ * statement in parsed query. Such statement can be executed as set
+ * based INSERT INTO ... SELECT ... FROM unnest(...) when some variable
+ * is an array.
+ */
+typedef struct
+{
+	int			values;				/* offset of VALUES keyword, or -1 */
+	int			start;				/* offset of first char of values list */
+	int			end;				/* offset of closing parenthesis */
+	bool		only_variables;		/* values list contains only bind variables */
+} ValuesClauseInfo;
+
+/*
+ * Entry of index of variables
+ */
+typedef struct
+{
+	char		refname[NAMEDATALEN];	/* hash key, should be first */
+	VariableData *var;
+} VariableHashEntry;
+
+/*
+ * Index of variables is used only for statements with more variables,
+ * for lower number of variables the list is searched.
+ */
+#define VARIABLES_HASH_THRESHOLD		16
+
+/*
+ * Result of parsing of query. It is shared by all cursors in session,
+ * and it is identified by original query string.
+ */
+typedef struct
+{
+	char	   *original_query;		/* hash key, should be first */
+	char	   *parsed_query;
+	int			nvariables;
+	char	  **varnames;			/* names of variables in order of varno */
+	int		   *positions;			/* positions of first occurrence */
+	List	   *returning_vars;		/* names of RETURNING INTO variables */
+	ValuesClauseInfo values_clause;
+	uint64		queryid;			/* hash of parsed query */
+	dlist_node	lru_node;
+} ParseCacheEntry;
+
+/*
+ * Saved plans are shared by all cursors in session. The plan is
+ * identified by query string and types of parameters.
+ */
+typedef struct
+{
+	char	   *query;
+	int			nargs;
+	Oid		   *types;
+	int			cursor_options;
+} PlanCacheKey;
+
+typedef struct
+{
+	PlanCacheKey key;				/* hash key, should be first */
+	SPIPlanPtr	plan;
+	int			refcount;			/* number of cursors that use this plan */
+	dlist_node	lru_node;
+} PlanCacheEntry;
+
+/*
+ * Performance counters of cursor. Times are in milliseconds.
+ */
+typedef struct
+{
+	int64		parse_calls;
+	double		parse_time;
+	int64		plan_hits;
+	int64		plan_misses;
+	int64		execute_calls;
+	double		execute_time;
+	int64		rows_processed;		/* rows processed by DML statements */
+	int64		fetch_calls;		/* round trips to portal */
+	int64		fetched_rows;
+	int64		fetched_bytes;
+	int64		cast_misses;		/* casts not cached by cursor */
+} CursorStats;
+
+#define CURSOR_STATS_COLS		11
+
+/*
+ * Statistics of statements shared by all backends. They are available
+ * only when the library is loaded by shared_preload_libraries. The entry
+ * is identified by hash of parsed query.
+ */
+typedef struct
+{
+	Oid			userid;
+	Oid			dbid;
+	uint64		queryid;			/* hash of parsed query */
+} StatementStatsKey;
+
+#define STATEMENT_TEXT_LEN		1024
+
+typedef struct
+{
+	StatementStatsKey key;			/* hash key, should be first */
+	slock_t		mutex;				/* protects counters */
+	int64		calls;
+	double		total_exec_time;
+	double		max_exec_time;
+	int64		rows_processed;
+	int64		fetch_calls;
+	double		total_fetch_time;
+	double		max_fetch_time;
+	int64		fetched_rows;
+	int64		bind_array_rows;	/* sum of sizes of bound arrays */
+	int64		max_bind_array_size;
+	char		query[STATEMENT_TEXT_LEN];	/* truncated parsed query */
+} StatementStatsEntry;
+
+#define STATEMENT_STATS_COLS	14
+
+typedef struct
+{
+	LWLock	   *lock;				/* protects the hash table */
+} StatementStatsShared;
+
 /*
  * dbms_sql cursor definition
  */
 typedef struct
 {
-	int16		cid;
+	int			cid;
 	char	   *parsed_query;
 	char	   *original_query;
+	uint64		queryid;			/* hash of parsed query */
 	int			nvariables;
 	int			max_colpos;
-	List	   *variables;
+	List	   *variables;			/* ordered by varno */
+	HTAB	   *variables_hash;		/* index of variables by name */
+	List	   *returning_vars;		/* names of RETURNING INTO variables */
+	TupleDesc	returning_tupdesc;	/* rows returned by DML statement */
+	Datum	  **returning_values;	/* returned values, column by column */
+	bool	  **returning_nulls;
+	uint64		returning_rows;
+	uint64		returning_size;		/* allocated size of column vectors */
 	List	   *columns;
-	char		cursorname[32];
+	ColumnData **columns_array;		/* index of columns by position */
+	int			columns_array_size;
+	char		cursorname[NAMEDATALEN];
 	Portal		portal;				/* one shot (execute) plan */
-	SPIPlanPtr	plan;
+	PlanCacheEntry *plan;			/* plan of parsed query */
+	PlanCacheEntry *set_based_plan;	/* plan of set based INSERT */
+	PlanCacheEntry *bulk_plan;		/* plan of query joined to bound arrays */
+	ValuesClauseInfo values_clause;
 	MemoryContext cursor_cxt;
 	MemoryContext cursor_xact_cxt;
 	MemoryContext tuples_cxt;
 	MemoryContext result_cxt;		/* short life memory context */
-	HeapTuple	tuples[1000];
+	HeapTuple  *tuples;				/* fetched rows, owned by tuples_cxt */
+	Datum	   *colvalues;			/* deformed fetched rows, column by column */
+	bool	   *colnulls;
 	TupleDesc	coltupdesc;
 	TupleDesc	tupdesc;
+	TupleDesc	values_tupdesc;		/* blessed tupdesc of column_values result */
 	CastCacheData *casts;
 	int			processed;
 	int			nread;
@@ -128,6 +371,21 @@ typedef struct
 	bool		executed;
 	Bitmapset  *array_columns;		/* set of array columns */
 	int			batch_rows;			/* how much rows should be fetched to fill target arrays */
+	int			prefetch_rows;		/* maximum rows fetched from portal, 0 is default */
+	int			avg_tuple_width;	/* average width of fetched rows, 0 is unknown */
+	bool		parallel;			/* result is read by one execution */
+	bool		holdable;			/* result survives end of transaction */
+	bool		direct_load;		/* INSERT is executed by table_multi_insert */
+	SPITupleTable *drained_tuptable; /* result read by execute, owned by cursor_xact_cxt */
+	uint64		drained_rows;		/* number of not returned rows of drained_tuptable */
+	Datum		desc_columns;		/* cached result of describe_columns */
+	int			desc_ncolumns;
+	Oid			desc_arraytypid;
+	PlanCacheEntry *desc_plan;		/* plan that was described */
+	CursorStats stats;				/* counters from opening of cursor */
+	double		log_duration;		/* time of last execute and its fetches */
+	int			log_fetches;
+	bool		log_logged;			/* the sequence was logged already */
 } CursorData;
 
 typedef enum
@@ -146,10 +404,91 @@ typedef enum
 	TOKEN_NONE
 } TokenType;
 
+typedef enum
+{
+	VALUES_STATE_START,				/* before INSERT keyword */
+	VALUES_STATE_TARGET,			/* before VALUES keyword */
+	VALUES_STATE_VALUES,			/* before values list */
+	VALUES_STATE_LIST,				/* inside values list */
+	VALUES_STATE_TAIL,				/* after values list */
+	VALUES_STATE_RETURNING,			/* inside RETURNING clause */
+	VALUES_STATE_END,				/* after semicolon */
+	VALUES_STATE_NONE				/* statement has not expected form */
+} ValuesClauseState;
+
 static MemoryContext	persist_cxt;
-static CursorData		cursors[MAX_CURSORS];
 
+/*
+ * Cursor slots are allocated on demand and never released. The cursor id
+ * is an index to this table. Closed slots are pushed to the stack of free
+ * slots, so open and close of cursor is O(1), and the cursor's memory
+ * context (only reset by close) is reused by next opened cursor.
+ */
+static CursorData	  **cursors = NULL;
+static int				ncursors = 0;			/* number of allocated slots */
+static int				cursors_size = 0;		/* size of cursors and free_cursors */
+static int			   *free_cursors = NULL;
+static int				nfree_cursors = 0;
+static int				nopened_cursors = 0;
+static uint32			portal_counter = 0;		/* used for unique names of portals */
+
+static int				max_cursors = 100;
+static int				log_min_duration = -1;
+static bool				set_based_insert = false;
+
+static HTAB			   *parse_cache = NULL;
+static dlist_head		parse_cache_lru;
+static int				parse_cache_nentries = 0;
+static MemoryContext	parse_cache_cxt = NULL;
+
+static int				parse_cache_size = 1024;
+
+static HTAB			   *plan_cache = NULL;
+static dlist_head		plan_cache_lru;
+static int				plan_cache_nentries = 0;
+static MemoryContext	plan_cache_cxt = NULL;
+static int64			plan_cache_hits = 0;
+static int64			plan_cache_misses = 0;
+
+/* counters of already closed cursors */
+static CursorStats		closed_cursors_stats;
+
+static int				plan_cache_size = 128;
+
+static HTAB			   *cast_cache = NULL;
+static MemoryContext	cast_cache_cxt = NULL;
+
+static int				prefetch_rows = 1000;
+static int				prefetch_bytes = 8192;		/* in kB */
+static int				max_memory = 0;				/* in kB */
+
+static int				max_statements = 1000;
+static StatementStatsShared *statements_shared = NULL;
+static HTAB			   *statements_hash = NULL;
+
+#if PG_VERSION_NUM >= 150000
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+
+#endif
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+static void release_plan(PlanCacheEntry *entry);
+static CastCacheEntry *get_cast_cache_entry(Oid targettypid, int32 targettypmod, Oid sourcetypid,
+											bool isexplicit);
+static Datum cast_value(CastCacheEntry *ccast, Datum value, bool isnull);
+static CastKernel get_cast_kernel(CastCacheEntry *centry, Oid sourcetypid);
+static void cast_cache_invalidate(Datum arg, int cacheid, uint32 hashvalue);
 static char *next_token(char *str, char **start, size_t *len, TokenType *typ, char **sep, size_t *seplen);
+static char *skip_plain_text(char *str);
+static bool contains_keyword(char *str, const char *keyword);
+static bool is_keyword(TokenType typ, char *start, size_t len, const char *keyword);
+static bool is_char(TokenType typ, char *start, char c);
+static ValuesClauseState values_clause_step(ValuesClauseState state, int *depth,
+											ValuesClauseInfo *vci,
+											TokenType typ, char *start, size_t len,
+											int offset, int next_offset);
 
 PGDLLEXPORT Datum dbms_sql_is_open(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_open_cursor(PG_FUNCTION_ARGS);
@@ -164,12 +503,30 @@ PGDLLEXPORT Datum dbms_sql_define_array(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_execute(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_fetch_rows(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_execute_and_fetch(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_fetch_all(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_column_value(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_column_value_f(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_column_value_f_support(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_column_values(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_variable_value(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_variable_value_f(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_last_row_count(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_set_prefetch_rows(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_set_parallel(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_set_holdable(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_set_direct_load(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_to_refcursor(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_to_cursor_number(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_describe_columns(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_describe_columns_f(PG_FUNCTION_ARGS);
 PGDLLEXPORT Datum dbms_sql_debug_cursor(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_explain(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_plan_cache_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_cursor_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_session_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_memory_usage(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_statement_stats(PG_FUNCTION_ARGS);
+PGDLLEXPORT Datum dbms_sql_statements_reset(PG_FUNCTION_ARGS);
 
 PG_FUNCTION_INFO_V1(dbms_sql_is_open);
 PG_FUNCTION_INFO_V1(dbms_sql_open_cursor);
@@ -184,1282 +541,5269 @@ PG_FUNCTION_INFO_V1(dbms_sql_define_array);
 PG_FUNCTION_INFO_V1(dbms_sql_execute);
 PG_FUNCTION_INFO_V1(dbms_sql_fetch_rows);
 PG_FUNCTION_INFO_V1(dbms_sql_execute_and_fetch);
+PG_FUNCTION_INFO_V1(dbms_sql_fetch_all);
 PG_FUNCTION_INFO_V1(dbms_sql_column_value);
 PG_FUNCTION_INFO_V1(dbms_sql_column_value_f);
+PG_FUNCTION_INFO_V1(dbms_sql_column_value_f_support);
+PG_FUNCTION_INFO_V1(dbms_sql_column_values);
+PG_FUNCTION_INFO_V1(dbms_sql_variable_value);
+PG_FUNCTION_INFO_V1(dbms_sql_variable_value_f);
 PG_FUNCTION_INFO_V1(dbms_sql_last_row_count);
+PG_FUNCTION_INFO_V1(dbms_sql_set_prefetch_rows);
+PG_FUNCTION_INFO_V1(dbms_sql_set_parallel);
+PG_FUNCTION_INFO_V1(dbms_sql_set_holdable);
+PG_FUNCTION_INFO_V1(dbms_sql_set_direct_load);
+PG_FUNCTION_INFO_V1(dbms_sql_to_refcursor);
+PG_FUNCTION_INFO_V1(dbms_sql_to_cursor_number);
 PG_FUNCTION_INFO_V1(dbms_sql_describe_columns);
 PG_FUNCTION_INFO_V1(dbms_sql_describe_columns_f);
 PG_FUNCTION_INFO_V1(dbms_sql_debug_cursor);
+PG_FUNCTION_INFO_V1(dbms_sql_explain);
+PG_FUNCTION_INFO_V1(dbms_sql_plan_cache_stats);
+PG_FUNCTION_INFO_V1(dbms_sql_cursor_stats);
+PG_FUNCTION_INFO_V1(dbms_sql_session_stats);
+PG_FUNCTION_INFO_V1(dbms_sql_memory_usage);
+PG_FUNCTION_INFO_V1(dbms_sql_statement_stats);
+PG_FUNCTION_INFO_V1(dbms_sql_statements_reset);
 
 
-void _PG_init(void);
-
-static int last_row_count = 0;
-
-void
-_PG_init(void)
-{
-	memset(cursors, 0, sizeof(cursors));
-
-	persist_cxt = AllocSetContextCreate(NULL,
-										"dbms_sql persist context",
-										ALLOCSET_DEFAULT_SIZES);
-}
-
-static void
-open_cursor(CursorData *c, int cid)
-{
-	c->cid = cid;
-
-	c->cursor_cxt = AllocSetContextCreate(persist_cxt,
-														   "dbms_sql cursor context",
-														   ALLOCSET_DEFAULT_SIZES);
-	c->assigned = true;
-}
-
 /*
- * FUNCTION dbms_sql.open_cursor() RETURNS int
+ * Size of shared memory used by statistics of statements
  */
-Datum
-dbms_sql_open_cursor(PG_FUNCTION_ARGS)
+static Size
+statements_memsize(void)
 {
-	int		i;
-
-	(void) fcinfo;
-
-	/* find and initialize first free slot */
-	for (i = 0; i < MAX_CURSORS; i++)
-	{
-		if (!cursors[i].assigned)
-		{
-			open_cursor(&cursors[i], i);
-
-			return i;
-		}
-	}
-
-	ereport(ERROR,
-			(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
-			 errmsg("too many opened cursors"),
-			 errdetail("There is not free slot for new dbms_sql's cursor."),
-			 errhint("You should to close unused cursors")));
+	return add_size(MAXALIGN(sizeof(StatementStatsShared)),
+					hash_estimate_size(max_statements, sizeof(StatementStatsEntry)));
 }
 
-static CursorData *
-get_cursor(FunctionCallInfo fcinfo, bool should_be_assigned)
+static void
+statements_shmem_request(void)
 {
-	CursorData	   *cursor;
-	int				cid;
 
-	if (PG_ARGISNULL(0))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("cursor id is NULL")));
+#if PG_VERSION_NUM >= 150000
 
-	cid = PG_GETARG_INT32(0);
-	if (cid < 0 && cid >= MAX_CURSORS)
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("value of cursor id is out of range")));
+	if (prev_shmem_request_hook)
+		prev_shmem_request_hook();
 
-	cursor = &cursors[cid];
-	if (!cursor->assigned && should_be_assigned)
-		ereport(ERROR,
-				(errcode(ERRCODE_UNDEFINED_CURSOR),
-				 errmsg("cursor is not valid")));
+#endif
 
-	return cursor;
+	RequestAddinShmemSpace(statements_memsize());
+	RequestNamedLWLockTranche("dbms_sql", 1);
 }
 
 /*
- * CREATE FUNCTION dbms_sql.is_open(c int) RETURNS bool;
+ * Allocate or attach to shared memory of statistics of statements
  */
-Datum
-dbms_sql_is_open(PG_FUNCTION_ARGS)
+static void
+statements_shmem_startup(void)
 {
-	CursorData	   *c;
-
-	c = get_cursor(fcinfo, false);
+	HASHCTL		info;
+	bool		found;
 
-	PG_RETURN_BOOL(c->assigned);
-}
+	if (prev_shmem_startup_hook)
+		prev_shmem_startup_hook();
 
-/*
- * Release all sources assigned to cursor
- */
-static void
-close_cursor(CursorData *c)
-{
-	if (c->executed && c->portal)
-		SPI_cursor_close(c->portal);
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
 
-	/* release all assigned memory */
-	if (c->cursor_cxt)
-		MemoryContextDelete(c->cursor_cxt);
+	statements_shared = ShmemInitStruct("dbms_sql statements",
+										sizeof(StatementStatsShared),
+										&found);
+	if (!found)
+		statements_shared->lock = &(GetNamedLWLockTranche("dbms_sql"))->lock;
 
-	if (c->cursor_xact_cxt)
-		MemoryContextDelete(c->cursor_xact_cxt);
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(StatementStatsKey);
+	info.entrysize = sizeof(StatementStatsEntry);
 
-	if (c->plan)
-		SPI_freeplan(c->plan);
+	statements_hash = ShmemInitHash("dbms_sql statements hash",
+									max_statements, max_statements,
+									&info,
+									HASH_ELEM | HASH_BLOBS);
 
-	memset(c, 0, sizeof(CursorData));
+	LWLockRelease(AddinShmemInitLock);
 }
 
-/*
- * PROCEDURE dbms_sql.close_cursor(c int)
- */
-Datum
-dbms_sql_close_cursor(PG_FUNCTION_ARGS)
+static int
+statement_stats_cmp(const void *a, const void *b)
 {
-	CursorData	   *c;
-
-	c = get_cursor(fcinfo, false);
+	int64		ca = (*(StatementStatsEntry *const *) a)->calls +
+					 (*(StatementStatsEntry *const *) a)->fetch_calls;
+	int64		cb = (*(StatementStatsEntry *const *) b)->calls +
+					 (*(StatementStatsEntry *const *) b)->fetch_calls;
 
-	close_cursor(c);
-
-	return (Datum) 0;
+	return ca < cb ? -1 : (ca > cb ? 1 : 0);
 }
 
 /*
- * Print state of cursor - just for debug purposes
+ * Returns new entry of statistics. When the hash table is full, then 5%
+ * of least used entries are removed. Exclusive lock should be held.
  */
-Datum
-dbms_sql_debug_cursor(PG_FUNCTION_ARGS)
+static StatementStatsEntry *
+statement_stats_entry_alloc(StatementStatsKey *key, const char *query)
 {
-	CursorData	   *c;
-	ListCell	   *lc;
+	StatementStatsEntry *entry;
+	bool		found;
+	int			len;
 
-	c = get_cursor(fcinfo, false);
-
-	if (c->assigned)
+	if (hash_get_num_entries(statements_hash) >= max_statements)
 	{
-		if (c->original_query)
-			elog(NOTICE, "orig query: \"%s\"", c->original_query);
+		HASH_SEQ_STATUS status;
+		StatementStatsEntry **entries;
+		int			nentries = 0;
+		int			nvictims;
+		int			i;
 
-		if (c->parsed_query)
-			elog(NOTICE, "parsed query: \"%s\"", c->parsed_query);
+		entries = palloc(sizeof(StatementStatsEntry *) * hash_get_num_entries(statements_hash));
 
-	}
-	else
-		elog(NOTICE, "cursor is not assigned");
+		hash_seq_init(&status, statements_hash);
+		while ((entry = hash_seq_search(&status)) != NULL)
+			entries[nentries++] = entry;
 
-	foreach(lc, c->variables)
-	{
-		VariableData *var = (VariableData *) lfirst(lc);
+		qsort(entries, nentries, sizeof(StatementStatsEntry *), statement_stats_cmp);
 
-		if (var->typoid != InvalidOid)
-		{
-			Oid		typOutput;
-			bool	isVarlena;
-			char   *str;
+		nvictims = Max(10, nentries / 20);
+		nvictims = Min(nvictims, nentries);
 
-			getTypeOutputInfo(var->typoid, &typOutput, &isVarlena);
-			str = OidOutputFunctionCall(typOutput, var->value);
+		for (i = 0; i < nvictims; i++)
+			hash_search(statements_hash, &entries[i]->key, HASH_REMOVE, NULL);
 
-			elog(NOTICE, "variable \"%s\" is assigned to \"%s\"", var->refname, str);
-		}
-		else
-			elog(NOTICE, "variable \"%s\" is not assigned", var->refname);
+		pfree(entries);
 	}
 
-	foreach(lc, c->columns)
+	entry = (StatementStatsEntry *) hash_search(statements_hash, key, HASH_ENTER, &found);
+
+	if (!found)
 	{
-		ColumnData *col = (ColumnData *) lfirst(lc);
+		memset((char *) entry + sizeof(StatementStatsKey), 0,
+			   sizeof(StatementStatsEntry) - sizeof(StatementStatsKey));
+		SpinLockInit(&entry->mutex);
 
-		elog(NOTICE, "column definition for position %d is %s",
-					  col->position,
-					  format_type_with_typemod(col->typoid, col->typmod));
+		len = pg_mbcliplen(query, strlen(query), STATEMENT_TEXT_LEN - 1);
+		memcpy(entry->query, query, len);
+		entry->query[len] = '\0';
 	}
 
-	return (Datum) 0;
+	return entry;
 }
 
 /*
- * Search a variable in cursor's variable list
+ * Add counters of one execution or one fetch of cursor to shared
+ * statistics of statement.
  */
-static VariableData *
-get_var(CursorData *c, char *refname, int position, bool append)
+static void
+statement_stats_store(CursorData *c,
+					  bool is_fetch,
+					  double time,
+					  uint64 rows,
+					  int64 array_size)
 {
-	ListCell	   *lc;
-	VariableData   *nvar;
-	MemoryContext	oldcxt;
+	StatementStatsKey key;
+	StatementStatsEntry *entry;
 
-	foreach(lc, c->variables)
-	{
-		VariableData *var = (VariableData *) lfirst(lc);
+	if (!statements_hash || !c->parsed_query)
+		return;
 
-		if (strcmp(var->refname, refname) == 0)
-			return var;
-	}
+	memset(&key, 0, sizeof(key));
+	key.userid = GetUserId();
+	key.dbid = MyDatabaseId;
+	key.queryid = c->queryid;
 
-	if (append)
-	{
-		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
-		nvar = palloc0(sizeof(VariableData));
+	LWLockAcquire(statements_shared->lock, LW_SHARED);
 
-		nvar->refname = pstrdup(refname);
-		nvar->varno = c->nvariables + 1;
-		nvar->position = position;
+	entry = (StatementStatsEntry *) hash_search(statements_hash, &key, HASH_FIND, NULL);
+	if (!entry)
+	{
+		/* new entry requires exclusive lock */
+		LWLockRelease(statements_shared->lock);
+		LWLockAcquire(statements_shared->lock, LW_EXCLUSIVE);
 
-		c->variables = lappend(c->variables, nvar);
-		c->nvariables += 1;
+		entry = statement_stats_entry_alloc(&key, c->parsed_query);
+	}
 
-		MemoryContextSwitchTo(oldcxt);
+	SpinLockAcquire(&entry->mutex);
 
-		return nvar;
+	if (is_fetch)
+	{
+		entry->fetch_calls += 1;
+		entry->total_fetch_time += time;
+		entry->max_fetch_time = Max(entry->max_fetch_time, time);
+		entry->fetched_rows += rows;
 	}
 	else
+	{
+		entry->calls += 1;
+		entry->total_exec_time += time;
+		entry->max_exec_time = Max(entry->max_exec_time, time);
+		entry->rows_processed += rows;
+		entry->bind_array_rows += array_size;
+		entry->max_bind_array_size = Max(entry->max_bind_array_size, array_size);
+	}
+
+	SpinLockRelease(&entry->mutex);
+
+	LWLockRelease(statements_shared->lock);
+}
+
+static void
+check_statements_shared(void)
+{
+	if (!statements_hash)
 		ereport(ERROR,
-				(errcode(ERRCODE_UNDEFINED_PARAMETER),
-				 errmsg("variable \"%s\" doesn't exists", refname)));
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("dbms_sql statistics of statements are not available"),
+				 errhint("The library dbms_sql should be loaded by shared_preload_libraries.")));
 }
 
+typedef struct
+{
+	StatementStatsEntry *entries;	/* copy of shared entries */
+	int			nentries;
+	int			current;
+	bool		all_texts;			/* texts of others users are visible */
+} StatementStatsState;
+
 /*
- * PROCEDURE dbms_sql.parse(c int, stmt varchar)
+ * FUNCTION dbms_sql.statement_stats(OUT userid oid, OUT dbid oid, OUT queryid bigint, ...,
+ *                                   OUT query text) RETURNS SETOF record
+ * Returns statistics of statements executed by all backends.
  */
 Datum
-dbms_sql_parse(PG_FUNCTION_ARGS)
+dbms_sql_statement_stats(PG_FUNCTION_ARGS)
 {
-	char	   *query,
-			   *ptr;
-	char	   *start;
-	size_t		len;
-	TokenType	typ;
-	StringInfoData	sinfo;
-	CursorData *c;
-	MemoryContext oldcxt;
+	FuncCallContext *funcctx;
+	StatementStatsState *state;
 
-	c = get_cursor(fcinfo, true);
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcxt;
+		TupleDesc	tupdesc;
+		HASH_SEQ_STATUS status;
+		StatementStatsEntry *entry;
 
-	if (PG_ARGISNULL(1))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("parsed query string is NULL")));
+		check_statements_shared();
 
-	if (c->parsed_query)
-	{
-		int		cid = c->cid;
+		funcctx = SRF_FIRSTCALL_INIT();
 
-		close_cursor(c);
-		open_cursor(c, cid);
-	}
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
 
-	query = text_to_cstring(PG_GETARG_TEXT_P(1));
-	ptr = query;
+		oldcxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-	initStringInfo(&sinfo);
+		funcctx->tuple_desc = BlessTupleDesc(CreateTupleDescCopy(tupdesc));
 
-	while (ptr)
-	{
-		char	   *startsep;
-		char	   *next_ptr;
-		size_t		seplen;
+		state = palloc0(sizeof(StatementStatsState));
+		state->all_texts = has_privs_of_role(GetUserId(), ROLE_PG_READ_ALL_STATS);
 
-		next_ptr = next_token(ptr, &start, &len, &typ, &startsep, &seplen);
-		if (next_ptr)
-		{
-			if (typ == TOKEN_DOLAR_STR)
-			{
-				appendStringInfo(&sinfo, "%.*s", (int) seplen, startsep);
-				appendStringInfo(&sinfo, "%.*s", (int) len, start);
-				appendStringInfo(&sinfo, "%.*s", (int) seplen, startsep);
-			}
-			else if (typ == TOKEN_BIND_VAR)
-			{
-				char	   *name = downcase_identifier(start, len, false, true);
-				VariableData *var = get_var(c, name, ptr - query, true);
+		/* the entries are copied, so the lock is not held between calls */
+		LWLockAcquire(statements_shared->lock, LW_SHARED);
 
-				appendStringInfo(&sinfo, "$%d", var->varno);
+		state->entries = palloc(sizeof(StatementStatsEntry) *
+								Max(hash_get_num_entries(statements_hash), 1));
 
-				pfree(name);
-			}
-			else if (typ == TOKEN_EXT_STR)
-			{
-				appendStringInfo(&sinfo, "e\'%.*s\'", (int) len, start);
-			}
-			else if (typ == TOKEN_STR)
-			{
-				appendStringInfo(&sinfo, "\'%.*s\'", (int) len, start);
-			}
-			else if (typ == TOKEN_QIDENTIF)
-			{
-				appendStringInfo(&sinfo, "\"%.*s\"", (int) len, start);
-			}
-			else if (typ != TOKEN_NONE)
-			{
-				appendStringInfo(&sinfo, "%.*s", (int) len, start);
-			}
+		hash_seq_init(&status, statements_hash);
+		while ((entry = hash_seq_search(&status)) != NULL)
+		{
+			StatementStatsEntry *copy = &state->entries[state->nentries++];
+
+			SpinLockAcquire(&entry->mutex);
+			memcpy(copy, entry, sizeof(StatementStatsEntry));
+			SpinLockRelease(&entry->mutex);
 		}
 
-		ptr = next_ptr;
+		LWLockRelease(statements_shared->lock);
+
+		funcctx->user_fctx = state;
+
+		MemoryContextSwitchTo(oldcxt);
 	}
 
-	/* save result to persist context */
-	oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
-	c->original_query = pstrdup(query);
-	c->parsed_query = pstrdup(sinfo.data);
+	funcctx = SRF_PERCALL_SETUP();
+	state = (StatementStatsState *) funcctx->user_fctx;
 
-	MemoryContextSwitchTo(oldcxt);
+	if (state->current < state->nentries)
+	{
+		StatementStatsEntry *entry = &state->entries[state->current++];
+		Datum		values[STATEMENT_STATS_COLS];
+		bool		nulls[STATEMENT_STATS_COLS];
+		HeapTuple	tuple;
 
-	pfree(query);
-	pfree(sinfo.data);
+		memset(nulls, 0, sizeof(nulls));
 
-	return (Datum) 0;
+		values[0] = ObjectIdGetDatum(entry->key.userid);
+		values[1] = ObjectIdGetDatum(entry->key.dbid);
+		values[2] = Int64GetDatum((int64) entry->key.queryid);
+		values[3] = Int64GetDatum(entry->calls);
+		values[4] = Float8GetDatum(entry->total_exec_time);
+		values[5] = Float8GetDatum(entry->max_exec_time);
+		values[6] = Int64GetDatum(entry->rows_processed);
+		values[7] = Int64GetDatum(entry->fetch_calls);
+		values[8] = Float8GetDatum(entry->total_fetch_time);
+		values[9] = Float8GetDatum(entry->max_fetch_time);
+		values[10] = Int64GetDatum(entry->fetched_rows);
+		values[11] = Int64GetDatum(entry->bind_array_rows);
+		values[12] = Int64GetDatum(entry->max_bind_array_size);
+
+		if (state->all_texts || entry->key.userid == GetUserId())
+			values[13] = CStringGetTextDatum(entry->query);
+		else
+			values[13] = CStringGetTextDatum("<insufficient privilege>");
+
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
 }
 
 /*
- * Calling procedure can be slow, so there is a function alternative
+ * FUNCTION dbms_sql.statements_reset() RETURNS void
  */
-static Datum
-bind_variable(PG_FUNCTION_ARGS)
+Datum
+dbms_sql_statements_reset(PG_FUNCTION_ARGS)
 {
-	CursorData *c;
-	VariableData *var;
-	char *varname, *varname_downcase;
-	Oid			valtype;
-	bool		is_unknown = false;
+	HASH_SEQ_STATUS status;
+	StatementStatsEntry *entry;
 
-	c = get_cursor(fcinfo, true);
+	check_statements_shared();
 
-	if (PG_ARGISNULL(1))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("name of bind variable is NULL")));
+	LWLockAcquire(statements_shared->lock, LW_EXCLUSIVE);
 
-	varname = text_to_cstring(PG_GETARG_TEXT_P(1));
-	if (*varname == ':')
-		varname += 1;
+	hash_seq_init(&status, statements_hash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+		hash_search(statements_hash, &entry->key, HASH_REMOVE, NULL);
 
-	varname_downcase = downcase_identifier(varname, strlen(varname), false, true);
-	var = get_var(c, varname_downcase, -1, false);
+	LWLockRelease(statements_shared->lock);
 
-	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
-	if (valtype == RECORDOID)
-		ereport(ERROR,
-			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			     errmsg("cannot to bind a value of record type")));
+	PG_RETURN_VOID();
+}
 
-	valtype = getBaseType(valtype);
-	if (valtype == UNKNOWNOID)
-	{
-		is_unknown = true;
-		valtype = TEXTOID;
-	}
+void _PG_init(void);
 
-	if (var->typoid != InvalidOid)
-	{
-		if (!var->typbyval)
-			pfree(DatumGetPointer(var->value));
+static int last_row_count = 0;
 
-		var->isnull = true;
-	}
+void
+_PG_init(void)
+{
+	DefineCustomIntVariable("dbms_sql.max_cursors",
+							"Sets the maximum number of opened dbms_sql cursors.",
+							NULL,
+							&max_cursors,
+							100,
+							1, 1000000,
+							PGC_USERSET,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.max_statements",
+							"Sets the maximum number of statements tracked by dbms_sql.statements.",
+							"It is used only when dbms_sql is loaded by shared_preload_libraries.",
+							&max_statements,
+							1000,
+							100, INT_MAX / 2,
+							PGC_POSTMASTER,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.parse_cache_size",
+							"Sets the maximum number of parsed queries cached in session.",
+							"Zero disables the cache.",
+							&parse_cache_size,
+							1024,
+							0, 1000000,
+							PGC_USERSET,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.plan_cache_size",
+							"Sets the maximum number of unused prepared plans kept in session.",
+							NULL,
+							&plan_cache_size,
+							128,
+							0, 100000,
+							PGC_USERSET,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.prefetch_rows",
+							"Sets the maximum number of rows fetched from cursor by one fetch.",
+							NULL,
+							&prefetch_rows,
+							1000,
+							1, INT_MAX / 2,
+							PGC_USERSET,
+							0,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.prefetch_bytes",
+							"Sets the maximum size of rows fetched from cursor by one fetch.",
+							"The number of fetched rows is reduced when rows are wide. Zero disables this limit.",
+							&prefetch_bytes,
+							8192,
+							0, MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.max_memory",
+							"Sets the maximum memory used by dbms_sql in session.",
+							"The fetched rows are reduced, and an error is raised when the limit is exceeded. Zero disables this limit.",
+							&max_memory,
+							0,
+							0, MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	DefineCustomBoolVariable("dbms_sql.set_based_insert",
+							 "When it is true, then bulk INSERT INTO ... VALUES is executed by one statement.",
+							 NULL,
+							 &set_based_insert,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL, NULL, NULL);
+
+	DefineCustomIntVariable("dbms_sql.log_min_duration",
+							"Sets the minimum time of execute and fetches of dbms_sql cursor above which the statement is logged.",
+							"The values of bind variables and plan are logged too. -1 disables logging.",
+							&log_min_duration,
+							-1,
+							-1, INT_MAX,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL, NULL, NULL);
+
+#if PG_VERSION_NUM >= 150000
+
+	MarkGUCPrefixReserved("dbms_sql");
 
-	var->typoid = valtype;
+#else
 
-	if (!PG_ARGISNULL(2))
+	EmitWarningsOnPlaceholders("dbms_sql");
+
+#endif
+
+	persist_cxt = AllocSetContextCreate(NULL,
+										"dbms_sql persist context",
+										ALLOCSET_DEFAULT_SIZES);
+
+	CacheRegisterSyscacheCallback(TYPEOID, cast_cache_invalidate, (Datum) 0);
+	CacheRegisterSyscacheCallback(CASTSOURCETARGET, cast_cache_invalidate, (Datum) 0);
+	CacheRegisterSyscacheCallback(PROCOID, cast_cache_invalidate, (Datum) 0);
+
+	/* shared statistics of statements */
+	if (process_shared_preload_libraries_in_progress)
 	{
-		MemoryContext	oldcxt;
 
-		get_typlenbyval(var->typoid, &var->typlen, &var->typbyval);
+#if PG_VERSION_NUM >= 150000
 
-		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+		prev_shmem_request_hook = shmem_request_hook;
+		shmem_request_hook = statements_shmem_request;
 
-		if (is_unknown)
-			var->value = CStringGetTextDatum(DatumGetPointer(PG_GETARG_DATUM(2)));
-		else
-			var->value = datumCopy(PG_GETARG_DATUM(2), var->typbyval, var->typlen);
+#else
 
-		var->isnull = false;
+		statements_shmem_request();
 
-		MemoryContextSwitchTo(oldcxt);
-	}
-	else
-		var->isnull = true;
+#endif
 
-	return (Datum) 0;
+		prev_shmem_startup_hook = shmem_startup_hook;
+		shmem_startup_hook = statements_shmem_startup;
+	}
 }
 
-/*
- * CREATE PROCEDURE dbms_sql.bind_variable(c int, name varchar2, value "any");
- */
-Datum
-dbms_sql_bind_variable(PG_FUNCTION_ARGS)
+static void
+open_cursor(CursorData *c, int cid)
 {
-	return bind_variable(fcinfo);
+	c->cid = cid;
+
+	/* the context can be there already from previous usage of this slot */
+	if (!c->cursor_cxt)
+		c->cursor_cxt = AllocSetContextCreate(persist_cxt,
+											  "dbms_sql cursor context",
+											  ALLOCSET_DEFAULT_SIZES);
+	c->assigned = true;
 }
 
 /*
- * CREATE FUNCTION dbms_sql.bind_variable_f(c int, name varchar2, value "any") RETURNS void;
+ * Allocate new cursor slot, returns its cursor id
  */
-Datum
-dbms_sql_bind_variable_f(PG_FUNCTION_ARGS)
+static int
+new_cursor_slot(void)
 {
-	return bind_variable(fcinfo);
-}
+	if (ncursors == cursors_size)
+	{
+		int		newsize = cursors_size > 0 ? cursors_size * 2 : 16;
 
-static void
-bind_array(FunctionCallInfo fcinfo, int index1, int index2)
-{
-	CursorData *c;
-	VariableData *var;
-	char *varname, *varname_downcase;
-	Oid			valtype;
-	Oid			elementtype;
-	bool		is_unknown = false;
+		if (cursors)
+		{
+			cursors = repalloc(cursors, sizeof(CursorData *) * newsize);
+			free_cursors = repalloc(free_cursors, sizeof(int) * newsize);
+		}
+		else
+		{
+			cursors = MemoryContextAlloc(persist_cxt, sizeof(CursorData *) * newsize);
+			free_cursors = MemoryContextAlloc(persist_cxt, sizeof(int) * newsize);
+		}
 
-	c = get_cursor(fcinfo, true);
+		cursors_size = newsize;
+	}
 
-	if (PG_ARGISNULL(1))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("name of bind variable is NULL")));
+	/* slots are not moved, a pointer to cursor can be used by callbacks */
+	cursors[ncursors] = MemoryContextAllocZero(persist_cxt, sizeof(CursorData));
 
-	varname = text_to_cstring(PG_GETARG_TEXT_P(1));
-	if (*varname == ':')
-		varname += 1;
+	return ncursors++;
+}
 
-	varname_downcase = downcase_identifier(varname, strlen(varname), false, true);
-	var = get_var(c, varname_downcase, -1, false);
+/*
+ * FUNCTION dbms_sql.open_cursor() RETURNS int
+ */
+static int
+open_new_cursor(void)
+{
+	int		cid;
 
-	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
-	if (valtype == RECORDOID)
+	if (nopened_cursors >= max_cursors)
 		ereport(ERROR,
-			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			     errmsg("cannot to bind a value of record type")));
-
-	valtype = getBaseType(valtype);
-	elementtype = get_element_type(valtype);
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("too many opened cursors"),
+				 errdetail("There is not free slot for new dbms_sql's cursor."),
+				 errhint("You should to close unused cursors or increase \"dbms_sql.max_cursors\".")));
+
+	/* prefer recently released slot, its memory context is ready */
+	if (nfree_cursors > 0)
+		cid = free_cursors[--nfree_cursors];
+	else
+		cid = new_cursor_slot();
 
-	if (!OidIsValid(elementtype))
-		ereport(ERROR,
-			    (errcode(ERRCODE_DATATYPE_MISMATCH),
-			     errmsg("value is not a array")));
+	open_cursor(cursors[cid], cid);
+	nopened_cursors += 1;
 
-	var->is_array = true;
-	var->typoid = valtype;
-	var->typelemid = elementtype;
+	return cid;
+}
 
-	get_typlenbyval(elementtype, &var->typelemlen, &var->typelembyval);
+Datum
+dbms_sql_open_cursor(PG_FUNCTION_ARGS)
+{
+	(void) fcinfo;
 
-	if (!PG_ARGISNULL(2))
-	{
-		MemoryContext	oldcxt;
+	PG_RETURN_INT32(open_new_cursor());
+}
 
-		get_typlenbyval(var->typoid, &var->typlen, &var->typbyval);
+static CursorData *
+get_cursor(FunctionCallInfo fcinfo, bool should_be_assigned)
+{
+	CursorData	   *cursor;
+	int				cid;
 
-		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("cursor id is NULL")));
 
-		if (is_unknown)
-			var->value = CStringGetTextDatum(DatumGetPointer(PG_GETARG_DATUM(2)));
-		else
-			var->value = datumCopy(PG_GETARG_DATUM(2), var->typbyval, var->typlen);
+	cid = PG_GETARG_INT32(0);
+	if (cid < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("value of cursor id is out of range")));
 
-		var->isnull = false;
+	cursor = cid < ncursors ? cursors[cid] : NULL;
+	if (cursor && !cursor->assigned)
+		cursor = NULL;
 
-		MemoryContextSwitchTo(oldcxt);
-	}
-	else
-		var->isnull = true;
+	if (!cursor && should_be_assigned)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_CURSOR),
+				 errmsg("cursor is not valid")));
 
-	var->index1 = index1;
-	var->index2 = index2;
+	return cursor;
 }
 
 /*
- * CREATE PROCEDURE dbms_sql.bind_array(c int, name varchar2, value anyarray);
+ * CREATE FUNCTION dbms_sql.is_open(c int) RETURNS bool;
  */
 Datum
-dbms_sql_bind_array_3(PG_FUNCTION_ARGS)
+dbms_sql_is_open(PG_FUNCTION_ARGS)
 {
-	bind_array(fcinfo, -1, -1);
+	CursorData	   *c;
 
-	return (Datum) 0;
+	c = get_cursor(fcinfo, false);
+
+	PG_RETURN_BOOL(c != NULL);
 }
 
 /*
- * CREATE PROCEDURE dbms_sql.bind_array(c int, name varchar2, value anyarray, index1 int, index2 int);
+ * Returns portal of cursor. The portal of holdable cursor can be dropped
+ * by abort of transaction, so it is searched by name.
  */
-Datum
-dbms_sql_bind_array_5(PG_FUNCTION_ARGS)
+static Portal
+get_portal(CursorData *c)
 {
-	int		index1, index2;
-
-	if (PG_ARGISNULL(3) || PG_ARGISNULL(4))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("index is NULL")));
+	if (c->portal)
+		c->portal = SPI_cursor_find(c->cursorname);
 
-	index1 = PG_GETARG_INT32(3);
-	index2 = PG_GETARG_INT32(4);
+	return c->portal;
+}
 
-	if (index1 < 0 || index2 < 0)
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("index is below zero")));
-
-	if (index1 > index2)
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("index1 is greater than index2")));
-
-	bind_array(fcinfo, index1, index2);
-
-	return (Datum) 0;
-}
-
-static ColumnData *
-get_col(CursorData *c, int position, bool append)
+/*
+ * Release all sources assigned to cursor
+ */
+static void
+close_cursor(CursorData *c)
 {
-	ListCell	   *lc;
-	ColumnData	   *ncol;
-	MemoryContext	oldcxt;
-
-	foreach(lc, c->columns)
-	{
-		ColumnData *col = (ColumnData *) lfirst(lc);
+	MemoryContext	cursor_cxt = c->cursor_cxt;
 
-		if (col->position == position)
-			return col;
-	}
+	if (c->executed && get_portal(c))
+		SPI_cursor_close(c->portal);
 
-	if (append)
-	{
-		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
-		ncol = palloc0(sizeof(ColumnData));
+	/*
+	 * release all assigned memory, the cursor context is only reset
+	 * and it will be reused.
+	 */
+	if (cursor_cxt)
+		MemoryContextReset(cursor_cxt);
 
-		ncol->position = position;
-		if (c->max_colpos < position)
-			c->max_colpos = position;
+	if (c->cursor_xact_cxt)
+		MemoryContextDelete(c->cursor_xact_cxt);
 
-		c->columns = lappend(c->columns, ncol);
+	release_plan(c->plan);
+	release_plan(c->set_based_plan);
+	release_plan(c->bulk_plan);
 
-		MemoryContextSwitchTo(oldcxt);
+	memset(c, 0, sizeof(CursorData));
 
-		return ncol;
-	}
-	else
-		ereport(ERROR,
-				(errcode(ERRCODE_UNDEFINED_COLUMN),
-				 errmsg("column no %d is not defined", position)));
+	c->cursor_cxt = cursor_cxt;
 }
 
 /*
- * CREATE PROCEDURE dbms_sql.define_column(c int, col int, value "any", column_size int DEFAULT -1);
+ * Add elapsed time from start to the counter
  */
-Datum
-dbms_sql_define_column(PG_FUNCTION_ARGS)
+static void
+add_elapsed_time(double *counter, instr_time start)
 {
-	CursorData *c;
-	ColumnData *col;
-	Oid			valtype;
-	Oid			basetype;
-	int		position;
-	int		colsize;
-	TYPCATEGORY category;
-	bool	ispreferred;
+	instr_time	duration;
 
-	c = get_cursor(fcinfo, true);
-
-	if (PG_ARGISNULL(1))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("column position (number) is NULL")));
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
 
-	position = PG_GETARG_INT32(1);
-	col = get_col(c, position, true);
+	*counter += INSTR_TIME_GET_MILLISEC(duration);
+}
 
-	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
-	if (valtype == RECORDOID)
-		ereport(ERROR,
-			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			     errmsg("cannot to define a column of record type")));
+static void
+add_cursor_stats(CursorStats *total, CursorStats *stats)
+{
+	total->parse_calls += stats->parse_calls;
+	total->parse_time += stats->parse_time;
+	total->plan_hits += stats->plan_hits;
+	total->plan_misses += stats->plan_misses;
+	total->execute_calls += stats->execute_calls;
+	total->execute_time += stats->execute_time;
+	total->rows_processed += stats->rows_processed;
+	total->fetch_calls += stats->fetch_calls;
+	total->fetched_rows += stats->fetched_rows;
+	total->fetched_bytes += stats->fetched_bytes;
+	total->cast_misses += stats->cast_misses;
+}
 
-	if (valtype == UNKNOWNOID)
-		valtype = TEXTOID;
+static void
+cursor_stats_values(CursorStats *stats, Datum *values)
+{
+	values[0] = Int64GetDatum(stats->parse_calls);
+	values[1] = Float8GetDatum(stats->parse_time);
+	values[2] = Int64GetDatum(stats->plan_hits);
+	values[3] = Int64GetDatum(stats->plan_misses);
+	values[4] = Int64GetDatum(stats->execute_calls);
+	values[5] = Float8GetDatum(stats->execute_time);
+	values[6] = Int64GetDatum(stats->rows_processed);
+	values[7] = Int64GetDatum(stats->fetch_calls);
+	values[8] = Int64GetDatum(stats->fetched_rows);
+	values[9] = Int64GetDatum(stats->fetched_bytes);
+	values[10] = Int64GetDatum(stats->cast_misses);
+}
 
-	basetype = getBaseType(valtype);
+/*
+ * Close cursor and returns its slot to the stack of free slots
+ */
+static void
+release_cursor(CursorData *c)
+{
+	int		cid = c->cid;
 
-	if (col->typoid != InvalidOid)
-		ereport(ERROR,
-			    (errcode(ERRCODE_DUPLICATE_COLUMN),
-			     errmsg("column is defined already")));
+	add_cursor_stats(&closed_cursors_stats, &c->stats);
 
-	col->typoid = valtype;
+	close_cursor(c);
 
-	if (PG_ARGISNULL(3))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("column_size is NULL")));
+	free_cursors[nfree_cursors++] = cid;
+	nopened_cursors -= 1;
+}
 
-	colsize = PG_GETARG_INT32(3);
+/*
+ * PROCEDURE dbms_sql.close_cursor(c int)
+ */
+Datum
+dbms_sql_close_cursor(PG_FUNCTION_ARGS)
+{
+	CursorData	   *c;
 
-	get_type_category_preferred(basetype, &category, &ispreferred);
-	col->typisstr = category == TYPCATEGORY_STRING;
-	col->typmod = (col->typisstr && colsize != -1) ? colsize + 4 : -1;
+	c = get_cursor(fcinfo, false);
 
-	get_typlenbyval(basetype, &col->typlen, &col->typbyval);
+	if (c)
+		release_cursor(c);
 
 	return (Datum) 0;
 }
 
 /*
- * CREATE PROCEDURE dbms_sql.define_array(c int, col int, value "anyarray", rowcount int, index1 int);
+ * Print state of cursor - just for debug purposes
  */
 Datum
-dbms_sql_define_array(PG_FUNCTION_ARGS)
+dbms_sql_debug_cursor(PG_FUNCTION_ARGS)
 {
-	CursorData *c;
-	ColumnData *col;
-	Oid			valtype;
-	Oid			basetype;
-	int		position;
-	int		rowcount;
-	int		index1;
-	Oid		elementtype;
-	TYPCATEGORY category;
-	bool	ispreferred;
-
-	c = get_cursor(fcinfo, true);
-
-	if (PG_ARGISNULL(1))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("column position (number) is NULL")));
-
-	position = PG_GETARG_INT32(1);
-	col = get_col(c, position, true);
-
-	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
-	if (valtype == RECORDOID)
-		ereport(ERROR,
-			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			     errmsg("cannot to define a column of record type")));
-
-	get_type_category_preferred(valtype, &category, &ispreferred);
-	if (category != TYPCATEGORY_ARRAY)
-		elog(ERROR, "defined value is not array");
-
-	col->typarrayoid = valtype;
-
-	basetype = getBaseType(valtype);
-	elementtype = get_element_type(basetype);
+	CursorData	   *c;
+	ListCell	   *lc;
 
-	if (!OidIsValid(elementtype))
-		ereport(ERROR,
-			    (errcode(ERRCODE_DATATYPE_MISMATCH),
-			     errmsg("column is not a array")));
+	c = get_cursor(fcinfo, false);
 
-	if (col->typoid != InvalidOid)
-		ereport(ERROR,
-			    (errcode(ERRCODE_DUPLICATE_COLUMN),
-			     errmsg("column is defined already")));
+	if (!c)
+	{
+		elog(NOTICE, "cursor is not assigned");
 
-	col->typoid = elementtype;
+		return (Datum) 0;
+	}
 
-	if (PG_ARGISNULL(3))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("cnt is NULL")));
+	if (c->original_query)
+		elog(NOTICE, "orig query: \"%s\"", c->original_query);
 
-	rowcount = PG_GETARG_INT32(3);
-	if (rowcount <= 0)
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("cnt is less or equal to zero")));
+	if (c->parsed_query)
+		elog(NOTICE, "parsed query: \"%s\"", c->parsed_query);
 
-	col->rowcount = rowcount;
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
 
-	if (PG_ARGISNULL(4))
-		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("lower_bnd is NULL")));
+		if (var->typoid != InvalidOid)
+		{
+			Oid		typOutput;
+			bool	isVarlena;
+			char   *str;
 
-	index1 = PG_GETARG_INT32(4);
-	if (index1 < 1)
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-				 errmsg("lower_bnd is less than one")));
+			getTypeOutputInfo(var->typoid, &typOutput, &isVarlena);
+			str = OidOutputFunctionCall(typOutput, var->value);
 
-	if (index1 != 1)
-		ereport(ERROR,
-			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-			     errmsg("lower_bnd can be only only \"1\"")));
+			elog(NOTICE, "variable \"%s\" is assigned to \"%s\"", var->refname, str);
+		}
+		else
+			elog(NOTICE, "variable \"%s\" is not assigned", var->refname);
+	}
 
-	col->index1 = index1;
+	foreach(lc, c->columns)
+	{
+		ColumnData *col = (ColumnData *) lfirst(lc);
 
-	get_typlenbyval(col->typoid, &col->typlen, &col->typbyval);
+		elog(NOTICE, "column definition for position %d is %s",
+					  col->position,
+					  format_type_with_typemod(col->typoid, col->typmod));
+	}
 
 	return (Datum) 0;
 }
 
-static void
-cursor_xact_cxt_deletion_callback(void *arg)
+/*
+ * FUNCTION dbms_sql.plan_cache_stats(OUT hits bigint, OUT misses bigint,
+ *                                    OUT cached_plans int)
+ */
+Datum
+dbms_sql_plan_cache_stats(PG_FUNCTION_ARGS)
 {
-	CursorData *cur = (CursorData *) arg;
+	TupleDesc	tupdesc;
+	HeapTuple	tuple;
+	Datum		values[3];
+	bool		nulls[3];
 
-	cur->cursor_xact_cxt = NULL;
-	cur->tuples_cxt = NULL;
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
 
-	cur->processed = 0;
-	cur->nread = 0;
-	cur->executed = false;
-	cur->tupdesc = NULL;
-	cur->coltupdesc = NULL;
-	cur->casts = NULL;
-	cur->array_columns = NULL;
+	memset(nulls, 0, sizeof(nulls));
+
+	values[0] = Int64GetDatum(plan_cache_hits);
+	values[1] = Int64GetDatum(plan_cache_misses);
+	values[2] = Int32GetDatum(plan_cache_nentries);
+
+	tuple = heap_form_tuple(tupdesc, values, nulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
 
-static long
-execute(CursorData *c)
+/*
+ * FUNCTION dbms_sql.cursor_stats(OUT cursor_id int, OUT parse_calls bigint, ...,
+ *                                OUT query text) RETURNS SETOF record
+ * Returns performance counters of opened cursors.
+ */
+Datum
+dbms_sql_cursor_stats(PG_FUNCTION_ARGS)
 {
-	last_row_count = 0;
+	FuncCallContext *funcctx;
+	int		   *cid;
 
-	/* clean space with saved result */
-	if (!c->cursor_xact_cxt)
+	if (SRF_IS_FIRSTCALL())
 	{
-		MemoryContextCallback *mcb;
 		MemoryContext oldcxt;
+		TupleDesc	tupdesc;
 
-		c->cursor_xact_cxt = AllocSetContextCreate(TopTransactionContext,
-												   "dbms_sql transaction context",
-												   ALLOCSET_DEFAULT_SIZES);
+		funcctx = SRF_FIRSTCALL_INIT();
 
-		oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
-		mcb = palloc0(sizeof(MemoryContextCallback));
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
 
-		mcb->func = cursor_xact_cxt_deletion_callback;
-		mcb->arg = c;
+		oldcxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-		MemoryContextRegisterResetCallback(c->cursor_xact_cxt, mcb);
+		funcctx->tuple_desc = BlessTupleDesc(CreateTupleDescCopy(tupdesc));
+		funcctx->user_fctx = palloc0(sizeof(int));
 
 		MemoryContextSwitchTo(oldcxt);
 	}
-	else
+
+	funcctx = SRF_PERCALL_SETUP();
+	cid = (int *) funcctx->user_fctx;
+
+	while (*cid < ncursors)
 	{
-		MemoryContext	save_cxt = c->cursor_xact_cxt;
+		CursorData *c = cursors[(*cid)++];
 
-		MemoryContextReset(c->cursor_xact_cxt);
-		c->cursor_xact_cxt = save_cxt;
+		if (c->assigned)
+		{
+			Datum		values[CURSOR_STATS_COLS + 2];
+			bool		nulls[CURSOR_STATS_COLS + 2];
+			HeapTuple	tuple;
 
-		c->casts = NULL;
-		c->tupdesc = NULL;
-		c->tuples_cxt = NULL;
-	}
+			memset(nulls, 0, sizeof(nulls));
 
-	c->result_cxt = AllocSetContextCreate(c->cursor_xact_cxt,
-										  "dbms_sql short life context",
-										  ALLOCSET_DEFAULT_SIZES);
+			values[0] = Int32GetDatum(c->cid);
+			cursor_stats_values(&c->stats, values + 1);
 
-	/*
-	 * When column definitions are available, build final query
-	 * and open cursor for fetching. When column definitions are
-	 * missing, then the statement can be called with high frequency
-	 * etc INSERT, UPDATE, so use cached plan.
-	 */
-	if (c->columns)
-	{
-		Datum	   *values;
-		Oid		   *types;
-		char *nulls;
-		ListCell   *lc;
-		int		i;
-		MemoryContext oldcxt;
-		int			batch_rows = -1;
+			if (c->original_query)
+				values[CURSOR_STATS_COLS + 1] = CStringGetTextDatum(c->original_query);
+			else
+				nulls[CURSOR_STATS_COLS + 1] = true;
 
-		oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
+			tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
 
-		/* prepare query arguments */
-		values = palloc(sizeof(Datum) * c->nvariables);
-		types = palloc(sizeof(Oid) * c->nvariables);
-		nulls = palloc(sizeof(char) * c->nvariables);
+			SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+		}
+	}
 
-		i = 0;
-		foreach(lc, c->variables)
-		{
-			VariableData *var = (VariableData *) lfirst(lc);
+	SRF_RETURN_DONE(funcctx);
+}
 
-			if (var->is_array)
-				ereport(ERROR,
-					    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-					     errmsg("a array (bulk) variable can be used only when no column is defined")));
+/*
+ * FUNCTION dbms_sql.session_stats(OUT parse_calls bigint, ...)
+ * Returns summary of performance counters of all cursors of session.
+ */
+Datum
+dbms_sql_session_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	HeapTuple	tuple;
+	CursorStats	total;
+	Datum		values[CURSOR_STATS_COLS];
+	bool		nulls[CURSOR_STATS_COLS];
+	int			i;
 
-			if (!var->isnull)
-			{
-				/* copy a value to xact memory context, to be independent on a outside */
-				values[i] = datumCopy(var->value, var->typbyval, var->typlen);
-				nulls[i] = ' ';
-			}
-			else
-				nulls[i] = 'n';
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
 
-			if (var->typoid == InvalidOid)
-				ereport(ERROR,
-					    (errcode(ERRCODE_UNDEFINED_PARAMETER),
-					     errmsg("variable \"%s\" has not a value", var->refname)));
+	total = closed_cursors_stats;
 
-			types[i] = var->typoid;
-			i += 1;
-		}
+	for (i = 0; i < ncursors; i++)
+	{
+		if (cursors[i]->assigned)
+			add_cursor_stats(&total, &cursors[i]->stats);
+	}
 
-		/* prepare or refresh target tuple descriptor, used for final tupconversion */
-		if (c->tupdesc)
-			FreeTupleDesc(c->tupdesc);
+	memset(nulls, 0, sizeof(nulls));
+	cursor_stats_values(&total, values);
 
-#if PG_VERSION_NUM >= 120000
+	tuple = heap_form_tuple(tupdesc, values, nulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
 
-		c->coltupdesc = CreateTemplateTupleDesc(c->max_colpos);
+/*
+ * Returns size of memory allocated by context and its children
+ */
+static int64
+get_context_memory(MemoryContext cxt)
+{
+#if PG_VERSION_NUM >= 130000
+
+	return cxt ? (int64) MemoryContextMemAllocated(cxt, true) : 0;
 
 #else
 
-		c->coltupdesc = CreateTemplateTupleDesc(c->max_colpos, false);
+	MemoryContextCounters totals;
+	MemoryContext child;
+	int64		result;
+
+	if (!cxt)
+		return 0;
+
+	memset(&totals, 0, sizeof(totals));
+
+	/* nothing is printed, only totals are counted */
+	cxt->methods->stats(cxt, NULL, NULL, &totals);
+
+	result = totals.totalspace;
+
+	for (child = cxt->firstchild; child != NULL; child = child->nextchild)
+		result += get_context_memory(child);
+
+	return result;
 
 #endif
+}
 
-		/* prepare current result column tupdesc */
-		for (i = 1; i <= c->max_colpos; i++)
-		{
-			ColumnData *col = get_col(c, i, false);
-			char genname[32];
+/*
+ * Returns size of memory used by saved plan. The contexts of saved
+ * plan are not under persist context.
+ */
+static int64
+get_plan_memory(SPIPlanPtr plan)
+{
+	ListCell   *lc;
+	int64		result;
 
-			snprintf(genname, 32, "col%d", i);
+	result = get_context_memory(plan->plancxt);
 
-			if (col->typarrayoid)
-			{
-				if (batch_rows != -1)
-					batch_rows = batch_rows > col->rowcount ? col->rowcount : batch_rows;
-				else
-					batch_rows = col->rowcount;
+	foreach(lc, plan->plancache_list)
+	{
+		CachedPlanSource *plansource = (CachedPlanSource *) lfirst(lc);
 
-				c->array_columns = bms_add_member(c->array_columns, i);
-			}
-			else
-			{
-				/* in this case we cannot do batch of rows */
-				batch_rows = 1;
-			}
+		result += get_context_memory(plansource->context);
 
-			TupleDescInitEntry(c->coltupdesc, (AttrNumber) i, genname, col->typoid, col->typmod, 0);
-		}
+		if (plansource->gplan)
+			result += get_context_memory(plansource->gplan->context);
+	}
 
-		c->batch_rows = batch_rows;
-		c->casts = palloc0(sizeof(CastCacheData) * c->coltupdesc->natts);
+	return result;
+}
 
-		MemoryContextSwitchTo(oldcxt);
+static int64
+get_plan_cache_memory(void)
+{
+	HASH_SEQ_STATUS status;
+	PlanCacheEntry *entry;
+	int64		result = 0;
 
-		snprintf(c->cursorname, sizeof(c->cursorname), "__orafce_dbms_sql_cursor_%d", c->cid);
+	if (!plan_cache)
+		return 0;
 
-		if (SPI_connect() != SPI_OK_CONNECT)
-			elog(ERROR, "SPI_connact failed");
+	hash_seq_init(&status, plan_cache);
 
-		c->portal = SPI_cursor_open_with_args(c->cursorname,
-											  c->parsed_query,
-											  c->nvariables,
-											  types,
-											  values,
-											  nulls,
-											  false,
-											  0);
+	while ((entry = (PlanCacheEntry *) hash_seq_search(&status)) != NULL)
+		result += get_plan_memory(entry->plan);
 
-		/* internal error */
-		if (c->portal == NULL)
-			elog(ERROR,
-				 "could not open cursor for query \"%s\": %s",
-				 c->parsed_query,
-				 SPI_result_code_string(SPI_result));
+	return result;
+}
 
-		SPI_finish();
+/*
+ * Returns size of memory used by transaction context of cursor without
+ * nested tuples and short life contexts.
+ */
+static int64
+get_cursor_xact_memory(CursorData *c)
+{
+	return get_context_memory(c->cursor_xact_cxt) -
+		   get_context_memory(c->tuples_cxt) -
+		   get_context_memory(c->result_cxt);
+}
 
-		/* Describe portal and prepare cast cache */
-		if (c->portal->tupDesc)
-		{
-			int		natts = 0;
-			TupleDesc tupdesc = c->portal->tupDesc;
+/*
+ * Returns size of all memory used by dbms_sql in session
+ */
+static int64
+get_memory_usage(void)
+{
+	int64		result;
+	int			i;
 
-			for (i = 0; i < tupdesc->natts; i++)
-			{
-				Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+	/* cursors, caches and transaction contexts of holdable cursors */
+	result = get_context_memory(persist_cxt);
 
-				if (att->attisdropped)
-					continue;
+	for (i = 0; i < ncursors; i++)
+	{
+		MemoryContext cxt = cursors[i]->cursor_xact_cxt;
 
-				natts += 1;
-			}
+		if (cxt && MemoryContextGetParent(cxt) != persist_cxt)
+			result += get_context_memory(cxt);
+	}
 
-			if (natts != c->coltupdesc->natts)
-				ereport(ERROR,
-					    (errcode(ERRCODE_DATA_EXCEPTION),
-					     errmsg("number of defined columns is different than number of query's columns")));
-		}
+	return result + get_plan_cache_memory();
+}
 
-		c->executed = true;
+/*
+ * Measuring of used memory walks all memory contexts of dbms_sql, so it
+ * is not done by every fetch. The last measured size is increased by size
+ * of fetched rows, and the memory is measured again after some calls, or
+ * when this estimate is near to dbms_sql.max_memory.
+ */
+#define MEMORY_USAGE_SAMPLE_CALLS		100
+
+static int64 memory_usage_estimate = -1;
+static int	memory_usage_calls = 0;
+
+static int64
+get_memory_usage_estimate(void)
+{
+	if (memory_usage_estimate < 0 ||
+		++memory_usage_calls >= MEMORY_USAGE_SAMPLE_CALLS ||
+		memory_usage_estimate > (int64) max_memory * 1024 / 4 * 3)
+	{
+		memory_usage_estimate = get_memory_usage();
+		memory_usage_calls = 0;
 	}
-	else
+
+	return memory_usage_estimate;
+}
+
+/*
+ * Forces measuring of used memory by next check, it is used after
+ * operations, that can allocate unknown size of memory.
+ */
+static void
+reset_memory_usage_estimate(void)
+{
+	memory_usage_estimate = -1;
+}
+
+static void
+add_memory_usage_estimate(int64 bytes)
+{
+	if (memory_usage_estimate >= 0)
+		memory_usage_estimate += bytes;
+}
+
+/*
+ * Raise an error when memory used by dbms_sql is over dbms_sql.max_memory.
+ * The error is raised only after exact measuring of memory.
+ */
+static void
+check_memory_limit(void)
+{
+	int64		used;
+
+	if (max_memory <= 0)
+		return;
+
+	used = get_memory_usage_estimate();
+
+	if (used > (int64) max_memory * 1024)
+	{
+		reset_memory_usage_estimate();
+		used = get_memory_usage_estimate();
+	}
+
+	if (used > (int64) max_memory * 1024)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("dbms_sql memory limit exceeded"),
+				 errdetail("The memory used by dbms_sql is %lld kB, but the limit is %d kB.",
+						   (long long) (used / 1024), max_memory),
+				 errhint("You should to close unused cursors or increase \"dbms_sql.max_memory\".")));
+}
+
+/*
+ * State of memory_usage function
+ */
+typedef struct
+{
+	int			nitems;
+	int			current;
+	int		   *cids;
+	const char **names;
+	int64	   *sizes;
+} MemoryUsageState;
+
+static void
+add_memory_usage_item(MemoryUsageState *state, int cid, const char *name, int64 size)
+{
+	state->cids[state->nitems] = cid;
+	state->names[state->nitems] = name;
+	state->sizes[state->nitems] = size;
+	state->nitems += 1;
+}
+
+/*
+ * FUNCTION dbms_sql.memory_usage(OUT cursor_id int, OUT context text, OUT bytes bigint)
+ * RETURNS SETOF record
+ * Returns memory used by contexts of opened cursors and by session's caches.
+ */
+Datum
+dbms_sql_memory_usage(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	MemoryUsageState *state;
+
+	if (SRF_IS_FIRSTCALL())
 	{
 		MemoryContext oldcxt;
-		Datum	   *values;
-		char	   *nulls;
-		ArrayIterator *iterators;
-		bool		has_iterator = false;
-		bool		has_value = true;
-		int			max_index1 = -1;
-		int			min_index2 = -1;
-		int			max_rows = -1;
-		long		result = 0;
-		ListCell   *lc;
+		TupleDesc	tupdesc;
+		int64		cursors_memory = 0;
+		int			maxitems = ncursors * 4 + 4;
 		int			i;
 
-		if (SPI_connect() != SPI_OK_CONNECT)
-			elog(ERROR, "SPI_connact failed");
+		funcctx = SRF_FIRSTCALL_INIT();
 
-		/* prepare, or reuse cached plan */
-		if (!c->plan)
-		{
-			Oid			   *types = NULL;
-			SPIPlanPtr		plan;
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			elog(ERROR, "return type must be a row type");
 
-			types = palloc(sizeof(Oid) * c->nvariables);
+		oldcxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-			i = 0;
-			foreach(lc, c->variables)
-			{
-				VariableData *var = (VariableData *) lfirst(lc);
+		funcctx->tuple_desc = BlessTupleDesc(CreateTupleDescCopy(tupdesc));
 
-				if (var->typoid == InvalidOid)
-					ereport(ERROR,
-						    (errcode(ERRCODE_UNDEFINED_PARAMETER),
-						     errmsg("variable \"%s\" has not a value", var->refname)));
+		state = palloc0(sizeof(MemoryUsageState));
+		state->cids = palloc(sizeof(int) * maxitems);
+		state->names = palloc(sizeof(char *) * maxitems);
+		state->sizes = palloc(sizeof(int64) * maxitems);
 
-				types[i++] = var->is_array ? var->typelemid : var->typoid;
-			}
+		for (i = 0; i < ncursors; i++)
+		{
+			CursorData *c = cursors[i];
 
-			plan = SPI_prepare(c->parsed_query, c->nvariables, types);
+			if (!c->assigned)
+				continue;
 
-			if (!plan)
-				/* internal error */
-				elog(ERROR, "cannot to prepare plan");
+			if (c->cursor_xact_cxt &&
+				MemoryContextGetParent(c->cursor_xact_cxt) == persist_cxt)
+				cursors_memory += get_context_memory(c->cursor_xact_cxt);
+
+			cursors_memory += get_context_memory(c->cursor_cxt);
 
-			if (types)
-				pfree(types);
+			add_memory_usage_item(state, c->cid, "cursor",
+								  get_context_memory(c->cursor_cxt));
 
-			SPI_keepplan(plan);
+			if (c->cursor_xact_cxt)
+				add_memory_usage_item(state, c->cid, "transaction",
+									  get_cursor_xact_memory(c));
 
-			c->plan = plan;
+			if (c->tuples_cxt)
+				add_memory_usage_item(state, c->cid, "tuples",
+									  get_context_memory(c->tuples_cxt));
+
+			if (c->result_cxt)
+				add_memory_usage_item(state, c->cid, "result",
+									  get_context_memory(c->result_cxt));
 		}
 
-		oldcxt = MemoryContextSwitchTo(c->result_cxt);
+		add_memory_usage_item(state, -1, "parse cache",
+							  get_context_memory(parse_cache_cxt));
+		add_memory_usage_item(state, -1, "plan cache",
+							  get_context_memory(plan_cache_cxt) +
+							  get_plan_cache_memory());
+		add_memory_usage_item(state, -1, "cast cache",
+							  get_context_memory(cast_cache_cxt));
 
-		/* prepare query arguments */
-		values = palloc(sizeof(Datum) * c->nvariables);
-		nulls = palloc(sizeof(char) * c->nvariables);
-		iterators = palloc(sizeof(ArrayIterator *) * c->nvariables);
+		/* cursor slots, reused memory of closed cursors */
+		add_memory_usage_item(state, -1, "session",
+							  get_context_memory(persist_cxt) -
+							  cursors_memory -
+							  get_context_memory(parse_cache_cxt) -
+							  get_context_memory(plan_cache_cxt) -
+							  get_context_memory(cast_cache_cxt));
 
-		has_value = true;
+		funcctx->user_fctx = state;
 
-		i = 0;
-		foreach(lc, c->variables)
-		{
-			VariableData *var = (VariableData *) lfirst(lc);
+		MemoryContextSwitchTo(oldcxt);
+	}
 
-			if (var->is_array)
-			{
-				if (!var->isnull)
-				{
-					iterators[i] = array_create_iterator(DatumGetArrayTypeP(var->value),
-														 0,
-														 NULL);
+	funcctx = SRF_PERCALL_SETUP();
+	state = (MemoryUsageState *) funcctx->user_fctx;
 
-					/* search do lowest common denominator */
-					if (var->index1 != -1)
-					{
-						if (max_index1 != -1)
-						{
-							max_index1 = max_index1 < var->index1 ? var->index1 : max_index1;
-							min_index2 = min_index2 > var->index2 ? var->index2 : min_index2;
-						}
-						else
-						{
-							max_index1 = var->index1;
-							min_index2 = var->index2;
-						}
-					}
+	if (state->current < state->nitems)
+	{
+		Datum		values[3];
+		bool		nulls[3];
+		HeapTuple	tuple;
+		int			i = state->current++;
 
-					has_iterator = true;
+		memset(nulls, 0, sizeof(nulls));
 
-				}
-				else
-				{
-					/* cannot to read data from NULL array */
-					has_value = false;
-					break;
-				}
-			}
-			else
-			{
-				values[i] = var->value;
-				nulls[i] = var->isnull ? 'n' : ' ';
-			}
+		if (state->cids[i] >= 0)
+			values[0] = Int32GetDatum(state->cids[i]);
+		else
+			nulls[0] = true;
 
-			i += 1;
-		}
+		values[1] = CStringGetTextDatum(state->names[i]);
+		values[2] = Int64GetDatum(state->sizes[i]);
 
-		if (has_iterator)
-		{
-			if (has_value)
-			{
-				if (max_index1 != -1)
-				{
-					max_rows = min_index2 - max_index1 + 1;
-					has_value = max_rows > 0;
+		tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
 
-					if (has_value && max_index1 > 1)
-					{
-						i = 0;
-						foreach(lc, c->variables)
-						{
-							VariableData *var = (VariableData *) lfirst(lc);
+		SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+static void
+add_var_to_hash(CursorData *c, VariableData *var)
+{
+	VariableHashEntry *entry;
+	bool		found;
+
+	entry = (VariableHashEntry *) hash_search(c->variables_hash, var->refname,
+											  HASH_ENTER, &found);
+	Assert(!found);
+
+	entry->var = var;
+}
+
+/*
+ * Append new variable to cursor's variable list
+ */
+static VariableData *
+new_var(CursorData *c, char *refname, int position)
+{
+	VariableData   *nvar;
+	MemoryContext	oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+	nvar = palloc0(sizeof(VariableData));
+
+	nvar->refname = pstrdup(refname);
+	nvar->varno = c->nvariables + 1;
+	nvar->position = position;
+
+	c->variables = lappend(c->variables, nvar);
+	c->nvariables += 1;
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (c->variables_hash)
+		add_var_to_hash(c, nvar);
+	else if (c->nvariables >= VARIABLES_HASH_THRESHOLD)
+	{
+		HASHCTL		ctl;
+		ListCell   *lc;
 
-							if (var->is_array)
-							{
-								int		j;
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = NAMEDATALEN;
+		ctl.entrysize = sizeof(VariableHashEntry);
+		ctl.hcxt = c->cursor_cxt;
 
-								Assert(iterators[i]);
+		c->variables_hash = hash_create("dbms_sql variables",
+										VARIABLES_HASH_THRESHOLD * 4,
+										&ctl,
+#if PG_VERSION_NUM >= 140000
+										HASH_ELEM | HASH_STRINGS | HASH_CONTEXT);
+#else
+										HASH_ELEM | HASH_CONTEXT);
+#endif
+
+		foreach(lc, c->variables)
+			add_var_to_hash(c, (VariableData *) lfirst(lc));
+	}
+
+	return nvar;
+}
+
+/*
+ * Returns true, when the name is a name of RETURNING INTO variable
+ */
+static bool
+is_returning_var(CursorData *c, char *refname)
+{
+	ListCell   *lc;
+
+	foreach(lc, c->returning_vars)
+	{
+		if (strcmp((char *) lfirst(lc), refname) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Search a variable in cursor's variable list. Returns NULL for output
+ * variables of RETURNING INTO clause, that are not used as input.
+ */
+static VariableData *
+get_var(CursorData *c, char *refname, int position, bool append)
+{
+	if (c->variables_hash)
+	{
+		VariableHashEntry *entry;
+
+		entry = (VariableHashEntry *) hash_search(c->variables_hash, refname,
+												  HASH_FIND, NULL);
+		if (entry)
+			return entry->var;
+	}
+	else
+	{
+		ListCell	   *lc;
+
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			if (strcmp(var->refname, refname) == 0)
+				return var;
+		}
+	}
+
+	if (append)
+		return new_var(c, refname, position);
+	else if (is_returning_var(c, refname))
+		return NULL;
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_PARAMETER),
+				 errmsg("variable \"%s\" doesn't exists", refname)));
+}
+
+static uint32
+parse_cache_hash(const void *key, Size keysize)
+{
+	const char *str = *((const char **) key);
+
+	return DatumGetUInt32(hash_any((const unsigned char *) str, strlen(str)));
+}
+
+static int
+parse_cache_match(const void *key1, const void *key2, Size keysize)
+{
+	return strcmp(*((const char **) key1), *((const char **) key2));
+}
+
+static void
+parse_cache_remove(ParseCacheEntry *entry)
+{
+	ParseCacheEntry data = *entry;
+	int			i;
+
+	dlist_delete(&entry->lru_node);
+
+	/* the key should be valid when the entry is removed */
+	hash_search(parse_cache, &data.original_query, HASH_REMOVE, NULL);
+	parse_cache_nentries -= 1;
+
+	for (i = 0; i < data.nvariables; i++)
+		pfree(data.varnames[i]);
+
+	if (data.varnames)
+	{
+		pfree(data.varnames);
+		pfree(data.positions);
+	}
+
+	list_free_deep(data.returning_vars);
+
+	pfree(data.parsed_query);
+	pfree(data.original_query);
+}
+
+/*
+ * Returns cached result of parsing, or NULL
+ */
+static ParseCacheEntry *
+parse_cache_lookup(char *query)
+{
+	ParseCacheEntry *entry;
+
+	if (!parse_cache || parse_cache_size <= 0)
+		return NULL;
+
+	entry = (ParseCacheEntry *) hash_search(parse_cache, &query, HASH_FIND, NULL);
+	if (entry)
+		dlist_move_head(&parse_cache_lru, &entry->lru_node);
+
+	return entry;
+}
+
+/*
+ * Save result of parsing of cursor's query to cache.
+ */
+static void
+parse_cache_store(CursorData *c)
+{
+	ParseCacheEntry *entry;
+	MemoryContext oldcxt;
+	char	   *key;
+	bool		found;
+	ListCell   *lc;
+	int			i;
+
+	if (parse_cache_size <= 0)
+		return;
+
+	if (!parse_cache)
+	{
+		HASHCTL		ctl;
+
+		parse_cache_cxt = AllocSetContextCreate(persist_cxt,
+												"dbms_sql parse cache",
+												ALLOCSET_DEFAULT_SIZES);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(char *);
+		ctl.entrysize = sizeof(ParseCacheEntry);
+		ctl.hash = parse_cache_hash;
+		ctl.match = parse_cache_match;
+		ctl.hcxt = parse_cache_cxt;
+
+		parse_cache = hash_create("dbms_sql parse cache",
+								  128,
+								  &ctl,
+								  HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+		dlist_init(&parse_cache_lru);
+	}
+
+	/* release least recently used entries */
+	while (parse_cache_nentries >= parse_cache_size)
+		parse_cache_remove(dlist_container(ParseCacheEntry, lru_node,
+										   dlist_tail_node(&parse_cache_lru)));
+
+	oldcxt = MemoryContextSwitchTo(parse_cache_cxt);
+
+	key = pstrdup(c->original_query);
+
+	entry = (ParseCacheEntry *) hash_search(parse_cache, &key, HASH_ENTER, &found);
+	Assert(!found);
+
+	entry->original_query = key;
+	entry->parsed_query = pstrdup(c->parsed_query);
+	entry->nvariables = c->nvariables;
+	entry->values_clause = c->values_clause;
+	entry->queryid = c->queryid;
+	entry->returning_vars = NIL;
+
+	foreach(lc, c->returning_vars)
+		entry->returning_vars = lappend(entry->returning_vars,
+										pstrdup((char *) lfirst(lc)));
+
+	if (c->nvariables > 0)
+	{
+		entry->varnames = palloc(sizeof(char *) * c->nvariables);
+		entry->positions = palloc(sizeof(int) * c->nvariables);
+
+		i = 0;
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			entry->varnames[i] = pstrdup(var->refname);
+			entry->positions[i++] = var->position;
+		}
+	}
+	else
+	{
+		entry->varnames = NULL;
+		entry->positions = NULL;
+	}
+
+	dlist_push_head(&parse_cache_lru, &entry->lru_node);
+	parse_cache_nentries += 1;
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * PROCEDURE dbms_sql.parse(c int, stmt varchar)
+ */
+Datum
+dbms_sql_parse(PG_FUNCTION_ARGS)
+{
+	char	   *query,
+			   *ptr,
+			   *span;
+	char	   *start;
+	size_t		len;
+	TokenType	typ;
+	StringInfoData	sinfo;
+	CursorData *c;
+	MemoryContext oldcxt;
+	ValuesClauseState values_state = VALUES_STATE_START;
+	int			values_depth = 0;
+	int			depth = 0;
+	bool		returning = false;
+	bool		returning_into = false;
+	bool		can_skip;
+	ParseCacheEntry *entry;
+	ListCell   *lc;
+	instr_time	start_time;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("parsed query string is NULL")));
+
+	/*
+	 * The variables can be there from previous parse, that failed
+	 * on syntax error, so the cursor should be cleaned too.
+	 */
+	if (c->parsed_query || c->variables || c->returning_vars)
+	{
+		int		cid = c->cid;
+		CursorStats stats = c->stats;
+		int		prefetch_rows = c->prefetch_rows;
+		bool	parallel = c->parallel;
+		bool	holdable = c->holdable;
+		bool	direct_load = c->direct_load;
+
+		close_cursor(c);
+		open_cursor(c, cid);
+
+		/* counters and options are related to cursor, not to statement */
+		c->stats = stats;
+		c->prefetch_rows = prefetch_rows;
+		c->parallel = parallel;
+		c->holdable = holdable;
+		c->direct_load = direct_load;
+	}
+
+	c->stats.parse_calls += 1;
+
+	query = text_to_cstring(PG_GETARG_TEXT_P(1));
+
+	entry = parse_cache_lookup(query);
+	if (entry)
+	{
+		int			i;
+
+		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+		c->original_query = pstrdup(query);
+		c->parsed_query = pstrdup(entry->parsed_query);
+
+		foreach(lc, entry->returning_vars)
+			c->returning_vars = lappend(c->returning_vars,
+										pstrdup((char *) lfirst(lc)));
+
+		MemoryContextSwitchTo(oldcxt);
+
+		for (i = 0; i < entry->nvariables; i++)
+			new_var(c, entry->varnames[i], entry->positions[i]);
+
+		c->values_clause = entry->values_clause;
+		c->queryid = entry->queryid;
+
+		pfree(query);
+
+		add_elapsed_time(&c->stats.parse_time, start_time);
+
+		return (Datum) 0;
+	}
+
+	ptr = query;
+	span = query;
+
+	memset(&c->values_clause, 0, sizeof(ValuesClauseInfo));
+
+	/* without RETURNING clause only bind variables are searched */
+	can_skip = !contains_keyword(query, "returning");
+
+	initStringInfo(&sinfo);
+
+	/*
+	 * Only bind variables and RETURNING INTO clause are changed. Other
+	 * tokens are not copied one by one, but as whole span of query.
+	 */
+	while (ptr)
+	{
+		char	   *startsep;
+		char	   *next_ptr;
+		size_t		seplen;
+
+		/*
+		 * When the statement cannot be executed as set based insert,
+		 * then keywords are not interesting, and the plain text between
+		 * bind variables, strings and comments is skipped at once.
+		 */
+		if (can_skip &&
+			(values_state == VALUES_STATE_NONE || values_state == VALUES_STATE_END))
+			ptr = skip_plain_text(ptr);
+
+		next_ptr = next_token(ptr, &start, &len, &typ, &startsep, &seplen);
+
+		/*
+		 * The list of output variables of RETURNING INTO clause is not
+		 * a part of executed query.
+		 */
+		if (next_ptr && returning_into && !is_char(typ, start, ';'))
+		{
+			appendBinaryStringInfo(&sinfo, span, ptr - span);
+			span = next_ptr;
+
+			if (typ == TOKEN_BIND_VAR)
+			{
+				oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+				c->returning_vars = lappend(c->returning_vars,
+											downcase_identifier(start, len, false, true));
+				MemoryContextSwitchTo(oldcxt);
+			}
+			else if (!(typ == TOKEN_SPACES || typ == TOKEN_COMMENT || typ == TOKEN_NONE ||
+					   is_char(typ, start, ',')))
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("syntax error in RETURNING INTO clause"),
+						 errdetail("Only bind variables are allowed after INTO keyword.")));
+		}
+		else if (next_ptr)
+		{
+			int			offset;
+			int			next_offset;
+
+			if (typ == TOKEN_BIND_VAR)
+			{
+				char	   *name = downcase_identifier(start, len, false, true);
+				VariableData *var = get_var(c, name, ptr - query, true);
+
+				appendBinaryStringInfo(&sinfo, span, ptr - span);
+				span = next_ptr;
+
+				offset = sinfo.len;
+				appendStringInfo(&sinfo, "$%d", var->varno);
+				next_offset = sinfo.len;
+
+				pfree(name);
+			}
+			else if (returning && depth == 0 && is_keyword(typ, start, len, "into"))
+			{
+				appendBinaryStringInfo(&sinfo, span, ptr - span);
+				span = next_ptr;
+
+				offset = next_offset = sinfo.len;
+				returning_into = true;
+			}
+			else
+			{
+				/* position of token in parsed query */
+				offset = sinfo.len + (ptr - span);
+				next_offset = offset + (next_ptr - ptr);
+			}
+
+			if (is_char(typ, start, '('))
+				depth += 1;
+			else if (is_char(typ, start, ')'))
+				depth -= 1;
+			else if (depth == 0 && is_keyword(typ, start, len, "returning"))
+				returning = true;
+
+			values_state = values_clause_step(values_state, &values_depth,
+											  &c->values_clause,
+											  typ, start, len,
+											  offset, next_offset);
+		}
+
+		ptr = next_ptr;
+	}
+
+	appendStringInfoString(&sinfo, span);
+
+	if (values_state != VALUES_STATE_TAIL &&
+		values_state != VALUES_STATE_RETURNING &&
+		values_state != VALUES_STATE_END)
+		c->values_clause.values = -1;
+
+	if (returning_into && !c->returning_vars)
+		ereport(ERROR,
+				(errcode(ERRCODE_SYNTAX_ERROR),
+				 errmsg("syntax error in RETURNING INTO clause"),
+				 errdetail("The list of variables is missing.")));
+
+	/* save result to persist context */
+	oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+	c->original_query = pstrdup(query);
+	c->parsed_query = pstrdup(sinfo.data);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	/* identifier of statement in shared statistics */
+	c->queryid = DatumGetUInt64(hash_any_extended((unsigned char *) sinfo.data,
+												  sinfo.len, 0));
+
+	parse_cache_store(c);
+
+	pfree(query);
+	pfree(sinfo.data);
+
+	add_elapsed_time(&c->stats.parse_time, start_time);
+
+	return (Datum) 0;
+}
+
+/*
+ * Release previous value of variable
+ */
+static void
+free_var_value(VariableData *var)
+{
+	if (var->typoid == InvalidOid || var->isnull || var->typbyval)
+		return;
+
+	if (VARATT_IS_EXTERNAL_EXPANDED(DatumGetPointer(var->value)))
+		DeleteExpandedObject(var->value);
+	else
+		pfree(DatumGetPointer(var->value));
+
+	var->isnull = true;
+}
+
+/*
+ * Returns true, when the value is same like the array bound to variable.
+ * Then the element cache of variable can be used again. Only flat values
+ * are compared, so the check is cheap against deconstruction of array.
+ */
+static bool
+is_same_array(VariableData *var, Datum value)
+{
+	ExpandedArrayHeader *eah;
+	ArrayType  *arr;
+
+	if (!var->is_array || var->isnull)
+		return false;
+
+	eah = (ExpandedArrayHeader *) DatumGetEOHP(var->value);
+	if (!eah->fvalue)
+		return false;
+
+	if (VARATT_IS_EXTERNAL_EXPANDED(DatumGetPointer(value)))
+	{
+		ExpandedArrayHeader *other = (ExpandedArrayHeader *) DatumGetEOHP(value);
+
+		if (other == eah)
+			return true;
+
+		if (other->ea_magic != EA_MAGIC || !other->fvalue)
+			return false;
+
+		arr = other->fvalue;
+	}
+	else if (VARATT_IS_EXTENDED(DatumGetPointer(value)))
+		return false;
+	else
+		arr = (ArrayType *) DatumGetPointer(value);
+
+	return VARSIZE(arr) == VARSIZE(eah->fvalue) &&
+		   memcmp(arr, eah->fvalue, VARSIZE(arr)) == 0;
+}
+
+/*
+ * Returns value of variable, that can be passed to SPI as parameter.
+ * The expanded objects are passed as read only.
+ */
+static Datum
+var_param_value(VariableData *var)
+{
+	return MakeExpandedObjectReadOnly(var->value, var->isnull, var->typlen);
+}
+
+/*
+ * Calling procedure can be slow, so there is a function alternative
+ */
+static Datum
+bind_variable(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	VariableData *var;
+	char *varname, *varname_downcase;
+	Oid			valtype;
+	bool		is_unknown = false;
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("name of bind variable is NULL")));
+
+	varname = text_to_cstring(PG_GETARG_TEXT_P(1));
+	if (*varname == ':')
+		varname += 1;
+
+	varname_downcase = downcase_identifier(varname, strlen(varname), false, true);
+	var = get_var(c, varname_downcase, -1, false);
+
+	/* like Oracle, the value of output variable is ignored */
+	if (!var)
+		return (Datum) 0;
+
+	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
+	if (valtype == RECORDOID)
+		ereport(ERROR,
+			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			     errmsg("cannot to bind a value of record type")));
+
+	valtype = getBaseType(valtype);
+	if (valtype == UNKNOWNOID)
+	{
+		is_unknown = true;
+		valtype = TEXTOID;
+	}
+
+	free_var_value(var);
+
+	var->typoid = valtype;
+	var->is_array = false;
+
+	if (!PG_ARGISNULL(2))
+	{
+		MemoryContext	oldcxt;
+		Datum		value = PG_GETARG_DATUM(2);
+
+		get_typlenbyval(var->typoid, &var->typlen, &var->typbyval);
+
+		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+
+		if (is_unknown)
+			var->value = CStringGetTextDatum(DatumGetPointer(value));
+		else if (var->typlen == -1 &&
+				 VARATT_IS_EXTERNAL_EXPANDED_RW(DatumGetPointer(value)))
+			/* we can take ownership of read/write expanded object */
+			var->value = TransferExpandedObject(value, c->cursor_cxt);
+		else
+			var->value = datumCopy(value, var->typbyval, var->typlen);
+
+		var->isnull = false;
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+	else
+		var->isnull = true;
+
+	return (Datum) 0;
+}
+
+/*
+ * CREATE PROCEDURE dbms_sql.bind_variable(c int, name varchar2, value "any");
+ */
+Datum
+dbms_sql_bind_variable(PG_FUNCTION_ARGS)
+{
+	return bind_variable(fcinfo);
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.bind_variable_f(c int, name varchar2, value "any") RETURNS void;
+ */
+Datum
+dbms_sql_bind_variable_f(PG_FUNCTION_ARGS)
+{
+	return bind_variable(fcinfo);
+}
+
+static void
+bind_array(FunctionCallInfo fcinfo, int index1, int index2)
+{
+	CursorData *c;
+	VariableData *var;
+	char *varname, *varname_downcase;
+	Oid			valtype;
+	Oid			elementtype;
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("name of bind variable is NULL")));
+
+	varname = text_to_cstring(PG_GETARG_TEXT_P(1));
+	if (*varname == ':')
+		varname += 1;
+
+	varname_downcase = downcase_identifier(varname, strlen(varname), false, true);
+	var = get_var(c, varname_downcase, -1, false);
+
+	/* like Oracle, the value of output variable is ignored */
+	if (!var)
+		return;
+
+	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
+	if (valtype == RECORDOID)
+		ereport(ERROR,
+			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			     errmsg("cannot to bind a value of record type")));
+
+	valtype = getBaseType(valtype);
+	elementtype = get_element_type(valtype);
+
+	if (!OidIsValid(elementtype))
+		ereport(ERROR,
+			    (errcode(ERRCODE_DATATYPE_MISMATCH),
+			     errmsg("value is not a array")));
+
+	/* only window is changed, when same array is bound again */
+	if (!PG_ARGISNULL(2) &&
+		var->typoid == valtype &&
+		is_same_array(var, PG_GETARG_DATUM(2)))
+	{
+		var->index1 = index1;
+		var->index2 = index2;
+
+		return;
+	}
+
+	free_var_value(var);
+
+	var->is_array = true;
+	var->elems = NULL;
+	var->elemnulls = NULL;
+	var->nelems = 0;
+	var->typoid = valtype;
+	var->typelemid = elementtype;
+
+	get_typlenbyval(elementtype, &var->typelemlen, &var->typelembyval);
+
+	if (!PG_ARGISNULL(2))
+	{
+		Datum		value = PG_GETARG_DATUM(2);
+		ExpandedArrayHeader *eah;
+
+		var->typlen = -1;
+		var->typbyval = false;
+
+		/*
+		 * The array is stored in expanded form, so elements can be read
+		 * without flattening or detoasting on every execution. Read/write
+		 * expanded array is not copied, we take ownership.
+		 */
+		if (VARATT_IS_EXTERNAL_EXPANDED_RW(DatumGetPointer(value)))
+			var->value = TransferExpandedObject(value, c->cursor_cxt);
+		else
+			var->value = expand_array(value, c->cursor_cxt, NULL);
+
+		var->isnull = false;
+
+		/*
+		 * Deconstruct the array only once per bind. Any window of elements
+		 * can be read directly by repeated executions.
+		 */
+		eah = (ExpandedArrayHeader *) DatumGetEOHP(var->value);
+		deconstruct_expanded_array(eah);
+
+		var->elems = eah->dvalues;
+		var->elemnulls = eah->dnulls;
+		var->nelems = eah->nelems;
+
+		reset_memory_usage_estimate();
+		check_memory_limit();
+	}
+	else
+		var->isnull = true;
+
+	var->index1 = index1;
+	var->index2 = index2;
+}
+
+/*
+ * CREATE PROCEDURE dbms_sql.bind_array(c int, name varchar2, value anyarray);
+ */
+Datum
+dbms_sql_bind_array_3(PG_FUNCTION_ARGS)
+{
+	bind_array(fcinfo, -1, -1);
+
+	return (Datum) 0;
+}
+
+/*
+ * CREATE PROCEDURE dbms_sql.bind_array(c int, name varchar2, value anyarray, index1 int, index2 int);
+ */
+Datum
+dbms_sql_bind_array_5(PG_FUNCTION_ARGS)
+{
+	int		index1, index2;
+
+	if (PG_ARGISNULL(3) || PG_ARGISNULL(4))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("index is NULL")));
+
+	index1 = PG_GETARG_INT32(3);
+	index2 = PG_GETARG_INT32(4);
+
+	if (index1 < 0 || index2 < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("index is below zero")));
+
+	if (index1 > index2)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("index1 is greater than index2")));
+
+	bind_array(fcinfo, index1, index2);
+
+	return (Datum) 0;
+}
+
+static ColumnData *
+get_col(CursorData *c, int position, bool append)
+{
+	ColumnData	   *ncol;
+	MemoryContext	oldcxt;
+
+	if (position < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("column position is less than one")));
+
+	/* the array of columns is indexed by position */
+	if (position > MaxTupleAttributeNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("column position is greater than %d", MaxTupleAttributeNumber)));
+
+	if (position <= c->columns_array_size && c->columns_array[position - 1])
+		return c->columns_array[position - 1];
+
+	if (append)
+	{
+		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+		ncol = palloc0(sizeof(ColumnData));
+
+		ncol->position = position;
+		if (c->max_colpos < position)
+			c->max_colpos = position;
+
+		c->columns = lappend(c->columns, ncol);
+
+		if (position > c->columns_array_size)
+		{
+			int		newsize = Max(position, c->columns_array_size * 2);
+
+			if (c->columns_array)
+			{
+				c->columns_array = repalloc(c->columns_array,
+											sizeof(ColumnData *) * newsize);
+				memset(c->columns_array + c->columns_array_size, 0,
+					   sizeof(ColumnData *) * (newsize - c->columns_array_size));
+			}
+			else
+				c->columns_array = palloc0(sizeof(ColumnData *) * newsize);
+
+			c->columns_array_size = newsize;
+		}
+
+		c->columns_array[position - 1] = ncol;
+
+		MemoryContextSwitchTo(oldcxt);
+
+		return ncol;
+	}
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_COLUMN),
+				 errmsg("column no %d is not defined", position)));
+}
+
+/*
+ * CREATE PROCEDURE dbms_sql.define_column(c int, col int, value "any", column_size int DEFAULT -1);
+ */
+Datum
+dbms_sql_define_column(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	ColumnData *col;
+	Oid			valtype;
+	Oid			basetype;
+	int		position;
+	int		colsize;
+	TYPCATEGORY category;
+	bool	ispreferred;
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("column position (number) is NULL")));
+
+	position = PG_GETARG_INT32(1);
+	col = get_col(c, position, true);
+
+	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
+	if (valtype == RECORDOID)
+		ereport(ERROR,
+			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			     errmsg("cannot to define a column of record type")));
+
+	if (valtype == UNKNOWNOID)
+		valtype = TEXTOID;
+
+	basetype = getBaseType(valtype);
+
+	if (col->typoid != InvalidOid)
+		ereport(ERROR,
+			    (errcode(ERRCODE_DUPLICATE_COLUMN),
+			     errmsg("column is defined already")));
+
+	col->typoid = valtype;
+
+	if (PG_ARGISNULL(3))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("column_size is NULL")));
+
+	colsize = PG_GETARG_INT32(3);
+
+	get_type_category_preferred(basetype, &category, &ispreferred);
+	col->typisstr = category == TYPCATEGORY_STRING;
+	col->typmod = (col->typisstr && colsize != -1) ? colsize + 4 : -1;
+
+	get_typlenbyval(basetype, &col->typlen, &col->typbyval);
+
+	return (Datum) 0;
+}
+
+/*
+ * CREATE PROCEDURE dbms_sql.define_array(c int, col int, value "anyarray", rowcount int, index1 int,
+ *                                        accumulate bool DEFAULT false);
+ */
+Datum
+dbms_sql_define_array(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	ColumnData *col;
+	Oid			valtype;
+	Oid			basetype;
+	int		position;
+	int		rowcount;
+	int		index1;
+	Oid		elementtype;
+	TYPCATEGORY category;
+	bool	ispreferred;
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("column position (number) is NULL")));
+
+	position = PG_GETARG_INT32(1);
+	col = get_col(c, position, true);
+
+	valtype = get_fn_expr_argtype(fcinfo->flinfo, 2);
+	if (valtype == RECORDOID)
+		ereport(ERROR,
+			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			     errmsg("cannot to define a column of record type")));
+
+	get_type_category_preferred(valtype, &category, &ispreferred);
+	if (category != TYPCATEGORY_ARRAY)
+		elog(ERROR, "defined value is not array");
+
+	col->typarrayoid = valtype;
+
+	basetype = getBaseType(valtype);
+	elementtype = get_element_type(basetype);
+
+	if (!OidIsValid(elementtype))
+		ereport(ERROR,
+			    (errcode(ERRCODE_DATATYPE_MISMATCH),
+			     errmsg("column is not a array")));
+
+	if (col->typoid != InvalidOid)
+		ereport(ERROR,
+			    (errcode(ERRCODE_DUPLICATE_COLUMN),
+			     errmsg("column is defined already")));
+
+	col->typoid = elementtype;
+
+	if (PG_ARGISNULL(3))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("cnt is NULL")));
+
+	rowcount = PG_GETARG_INT32(3);
+	if (rowcount <= 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("cnt is less or equal to zero")));
+
+	col->rowcount = rowcount;
+
+	if (PG_ARGISNULL(4))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("lower_bnd is NULL")));
+
+	index1 = PG_GETARG_INT32(4);
+	if (index1 < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("lower_bnd is less than one")));
+
+	if (PG_NARGS() > 5 && !PG_ARGISNULL(5))
+		col->accumulate = PG_GETARG_BOOL(5);
+
+	if (index1 != 1 && !col->accumulate)
+		ereport(ERROR,
+			    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			     errmsg("lower_bnd can be only only \"1\""),
+			     errhint("Use accumulate mode for other lower bounds.")));
+
+	col->index1 = index1;
+
+	get_typlenbyval(col->typoid, &col->typlen, &col->typbyval);
+
+	return (Datum) 0;
+}
+
+static void
+cursor_xact_cxt_deletion_callback(void *arg)
+{
+	CursorData *cur = (CursorData *) arg;
+
+	cur->cursor_xact_cxt = NULL;
+	cur->tuples_cxt = NULL;
+
+	cur->processed = 0;
+	cur->nread = 0;
+	cur->executed = false;
+	cur->portal = NULL;
+	cur->drained_tuptable = NULL;
+	cur->drained_rows = 0;
+	cur->returning_tupdesc = NULL;
+	cur->returning_values = NULL;
+	cur->returning_nulls = NULL;
+	cur->returning_rows = 0;
+	cur->returning_size = 0;
+	cur->tupdesc = NULL;
+	cur->tuples = NULL;
+	cur->colvalues = NULL;
+	cur->colnulls = NULL;
+	cur->coltupdesc = NULL;
+	cur->values_tupdesc = NULL;
+	cur->casts = NULL;
+	cur->array_columns = NULL;
+}
+
+/*
+ * Prepare empty transaction context of cursor. The reset callback
+ * cleans the cursor's state, when this context is released.
+ */
+static void
+reset_cursor_xact_cxt(CursorData *c)
+{
+	MemoryContextCallback *mcb;
+	MemoryContext oldcxt;
+
+	MemoryContext parent;
+
+	/* previous result is not valid anymore */
+	if (c->executed && get_portal(c))
+		SPI_cursor_close(c->portal);
+
+	c->portal = NULL;
+
+	/* the state of holdable cursor is not released by end of transaction */
+	parent = c->holdable ? persist_cxt : TopTransactionContext;
+
+	if (!c->cursor_xact_cxt)
+		c->cursor_xact_cxt = AllocSetContextCreate(parent,
+												   "dbms_sql transaction context",
+												   ALLOCSET_DEFAULT_SIZES);
+	else
+	{
+		MemoryContext	save_cxt = c->cursor_xact_cxt;
+
+		/* the callback cleans the state and forgets the context */
+		MemoryContextReset(save_cxt);
+		c->cursor_xact_cxt = save_cxt;
+
+		MemoryContextSetParent(save_cxt, parent);
+	}
+
+	/* reset removes registered callbacks, so it should be registered again */
+	oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
+	mcb = palloc0(sizeof(MemoryContextCallback));
+
+	mcb->func = cursor_xact_cxt_deletion_callback;
+	mcb->arg = c;
+
+	MemoryContextRegisterResetCallback(c->cursor_xact_cxt, mcb);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+static uint32
+plan_cache_hash(const void *key, Size keysize)
+{
+	const PlanCacheKey *k = (const PlanCacheKey *) key;
+	uint32		h;
+
+	h = DatumGetUInt32(hash_any((const unsigned char *) k->query, strlen(k->query)));
+
+	if (k->nargs > 0)
+		h ^= DatumGetUInt32(hash_any((const unsigned char *) k->types,
+									 sizeof(Oid) * k->nargs));
+
+	h ^= (uint32) k->cursor_options;
+
+	return h;
+}
+
+static int
+plan_cache_match(const void *key1, const void *key2, Size keysize)
+{
+	const PlanCacheKey *k1 = (const PlanCacheKey *) key1;
+	const PlanCacheKey *k2 = (const PlanCacheKey *) key2;
+
+	if (k1->nargs != k2->nargs ||
+		k1->cursor_options != k2->cursor_options)
+		return 1;
+
+	if (k1->nargs > 0 &&
+		memcmp(k1->types, k2->types, sizeof(Oid) * k1->nargs) != 0)
+		return 1;
+
+	return strcmp(k1->query, k2->query);
+}
+
+/*
+ * Remove unused plans over the limit. The plans used by any cursor are
+ * not removed.
+ */
+static void
+plan_cache_cleanup(void)
+{
+	dlist_node *node;
+
+	if (plan_cache_nentries <= plan_cache_size)
+		return;
+
+	node = dlist_tail_node(&plan_cache_lru);
+
+	while (plan_cache_nentries > plan_cache_size)
+	{
+		PlanCacheEntry *entry = dlist_container(PlanCacheEntry, lru_node, node);
+		dlist_node *prev;
+
+		prev = dlist_has_prev(&plan_cache_lru, node) ?
+			dlist_prev_node(&plan_cache_lru, node) : NULL;
+
+		if (entry->refcount == 0)
+		{
+			PlanCacheKey key = entry->key;
+
+			dlist_delete(&entry->lru_node);
+			SPI_freeplan(entry->plan);
+
+			hash_search(plan_cache, &key, HASH_REMOVE, NULL);
+			plan_cache_nentries -= 1;
+
+			pfree(key.query);
+			if (key.types)
+				pfree(key.types);
+		}
+
+		if (!prev)
+			break;
+
+		node = prev;
+	}
+}
+
+/*
+ * Cursor doesn't use this plan already
+ */
+static void
+release_plan(PlanCacheEntry *entry)
+{
+	if (!entry)
+		return;
+
+	Assert(entry->refcount > 0);
+	entry->refcount -= 1;
+
+	if (entry->refcount == 0)
+		plan_cache_cleanup();
+}
+
+/*
+ * Returns true, when saved plan was prepared for parameters of same types
+ * and with same cursor options.
+ */
+static bool
+plan_is_usable(PlanCacheEntry *entry, int nargs, Oid *types, int cursor_options)
+{
+	if (!entry || entry->key.cursor_options != cursor_options)
+		return false;
+
+	return nargs == 0 || memcmp(entry->key.types, types, sizeof(Oid) * nargs) == 0;
+}
+
+/*
+ * Returns saved plan for query. The plan is searched in session plan
+ * cache first. The previously used plan is released.
+ */
+static SPIPlanPtr
+get_plan(CursorData *c,
+		 PlanCacheEntry **entryptr,
+		 char *query,
+		 int nargs,
+		 Oid *types,
+		 int cursor_options)
+{
+	PlanCacheEntry *entry;
+	PlanCacheKey key;
+	bool		found;
+
+	release_plan(*entryptr);
+	*entryptr = NULL;
+
+	if (!plan_cache)
+	{
+		HASHCTL		ctl;
+
+		plan_cache_cxt = AllocSetContextCreate(persist_cxt,
+											   "dbms_sql plan cache",
+											   ALLOCSET_DEFAULT_SIZES);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(PlanCacheKey);
+		ctl.entrysize = sizeof(PlanCacheEntry);
+		ctl.hash = plan_cache_hash;
+		ctl.match = plan_cache_match;
+		ctl.hcxt = plan_cache_cxt;
+
+		plan_cache = hash_create("dbms_sql plan cache",
+								 128,
+								 &ctl,
+								 HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT);
+
+		dlist_init(&plan_cache_lru);
+	}
+
+	key.query = query;
+	key.nargs = nargs;
+	key.types = types;
+	key.cursor_options = cursor_options;
+
+	entry = (PlanCacheEntry *) hash_search(plan_cache, &key, HASH_FIND, NULL);
+	if (entry)
+	{
+		plan_cache_hits += 1;
+		c->stats.plan_hits += 1;
+		dlist_move_head(&plan_cache_lru, &entry->lru_node);
+	}
+	else
+	{
+		SPIPlanPtr	plan;
+		MemoryContext oldcxt;
+
+		plan_cache_misses += 1;
+		c->stats.plan_misses += 1;
+
+		plan = SPI_prepare_cursor(query, nargs, types, cursor_options);
+
+		if (!plan)
+			/* internal error */
+			elog(ERROR, "cannot to prepare plan");
+
+		SPI_keepplan(plan);
+
+		oldcxt = MemoryContextSwitchTo(plan_cache_cxt);
+
+		key.query = pstrdup(query);
+		if (nargs > 0)
+		{
+			key.types = palloc(sizeof(Oid) * nargs);
+			memcpy(key.types, types, sizeof(Oid) * nargs);
+		}
+		else
+			key.types = NULL;
+
+		MemoryContextSwitchTo(oldcxt);
+
+		entry = (PlanCacheEntry *) hash_search(plan_cache, &key, HASH_ENTER, &found);
+		Assert(!found);
+
+		entry->key = key;
+		entry->plan = plan;
+		entry->refcount = 0;
+		dlist_push_head(&plan_cache_lru, &entry->lru_node);
+
+		plan_cache_nentries += 1;
+	}
+
+	entry->refcount += 1;
+	*entryptr = entry;
+
+	/* there can be unused plans over limit */
+	plan_cache_cleanup();
+
+	return entry->plan;
+}
+
+/*
+ * Returns cursor options used for planning of cursor's query
+ */
+static int
+get_cursor_options(CursorData *c)
+{
+	int			cursor_options = 0;
+
+	if (c->parallel)
+		cursor_options |= CURSOR_OPT_PARALLEL_OK;
+
+	if (c->holdable)
+		cursor_options |= CURSOR_OPT_HOLD;
+
+	return cursor_options;
+}
+
+/*
+ * Returns prepared plan of cursor's query. The plan is saved, and it is
+ * reused until the types of bind variables are changed. SPI should be
+ * connected. Only lookups in session plan cache are counted as hits
+ * or misses.
+ */
+static SPIPlanPtr
+prepare_plan(CursorData *c, Oid *types)
+{
+	int			cursor_options = get_cursor_options(c);
+
+	if (plan_is_usable(c->plan, c->nvariables, types, cursor_options))
+		return c->plan->plan;
+
+	return get_plan(c, &c->plan, c->parsed_query, c->nvariables, types,
+					cursor_options);
+}
+
+/*
+ * Appends part of query to sinfo. The references to array variables
+ * are replaced by columns of unnest function. The copy stops on
+ * semicolon.
+ */
+static void
+append_unnested_query(CursorData *c, StringInfo sinfo, char *ptr, char *end)
+{
+	bool	   *is_array;
+	ListCell   *lc;
+
+	is_array = palloc0(sizeof(bool) * (c->nvariables + 1));
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		is_array[var->varno] = var->is_array;
+	}
+
+	while (ptr < end)
+	{
+		char	   *start;
+		char	   *sep;
+		char	   *next_ptr;
+		size_t		len;
+		size_t		seplen;
+		TokenType	typ;
+
+		next_ptr = next_token(ptr, &start, &len, &typ, &sep, &seplen);
+
+		if (typ == TOKEN_NONE || (typ == TOKEN_OTHER && *start == ';'))
+			break;
+
+		if (typ == TOKEN_OTHER && *start == '$' && isdigit((unsigned char) *next_ptr))
+		{
+			char	   *aux = next_ptr;
+			int			varno = 0;
+
+			while (isdigit((unsigned char) *aux))
+				varno = varno * 10 + (*aux++ - '0');
+
+			if (varno <= c->nvariables && is_array[varno])
+			{
+				appendStringInfo(sinfo, "__dbms_sql_u.v%d", varno);
+				ptr = aux;
+				continue;
+			}
+		}
+
+		appendBinaryStringInfo(sinfo, ptr, next_ptr - ptr);
+		ptr = next_ptr;
+	}
+
+	pfree(is_array);
+}
+
+/*
+ * Appends unnest(...) WITH ORDINALITY AS __dbms_sql_u(...) function call.
+ * The columns are named vN by number of array variable, and __n is
+ * number of element.
+ */
+static void
+append_unnest_clause(CursorData *c, StringInfo sinfo)
+{
+	bool		is_first;
+	ListCell   *lc;
+
+	appendStringInfoString(sinfo, "unnest(");
+
+	is_first = true;
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->is_array)
+		{
+			appendStringInfo(sinfo, is_first ? "$%d" : ", $%d", var->varno);
+			is_first = false;
+		}
+	}
+
+	appendStringInfoString(sinfo, ") WITH ORDINALITY AS __dbms_sql_u(");
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->is_array)
+			appendStringInfo(sinfo, "v%d, ", var->varno);
+	}
+
+	appendStringInfoString(sinfo, "__n)");
+}
+
+/*
+ * Returns true, when INSERT INTO ... VALUES (...) statement with bound
+ * arrays can be executed as one set based INSERT. RETURNING clause can
+ * use only columns of target table, so arrays used there are allowed
+ * only in row by row mode.
+ */
+static bool
+use_set_based_insert(CursorData *c)
+{
+	char	   *ptr;
+	bool	   *is_array;
+	bool		has_arrays = false;
+	bool		result = true;
+	ListCell   *lc;
+
+	if (!set_based_insert || c->values_clause.values == -1)
+		return false;
+
+	is_array = palloc0(sizeof(bool) * (c->nvariables + 1));
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		is_array[var->varno] = var->is_array;
+		has_arrays |= var->is_array;
+	}
+
+	if (!has_arrays)
+		result = false;
+
+	ptr = c->parsed_query + c->values_clause.end + 1;
+
+	while (result && ptr && *ptr)
+	{
+		char	   *start;
+		char	   *sep;
+		char	   *next_ptr;
+		size_t		len;
+		size_t		seplen;
+		TokenType	typ;
+
+		next_ptr = next_token(ptr, &start, &len, &typ, &sep, &seplen);
+
+		if (typ == TOKEN_NONE)
+			break;
+
+		if (typ == TOKEN_OTHER && *start == '$' && isdigit((unsigned char) *next_ptr))
+		{
+			char	   *aux = next_ptr;
+			int			varno = 0;
+
+			while (isdigit((unsigned char) *aux))
+				varno = varno * 10 + (*aux++ - '0');
+
+			if (varno <= c->nvariables && is_array[varno])
+				result = false;
+		}
+
+		ptr = next_ptr;
+	}
+
+	pfree(is_array);
+
+	return result;
+}
+
+/*
+ * Builds INSERT INTO ... SELECT ... FROM unnest(...) statement from
+ * INSERT INTO ... VALUES (...) statement. The references to array variables
+ * are replaced by columns of unnest function. Two additional parameters
+ * are numbers of first and last used element of arrays.
+ */
+static char *
+set_based_insert_query(CursorData *c)
+{
+	StringInfoData sinfo;
+	ValuesClauseInfo *vci = &c->values_clause;
+	char	   *query = c->parsed_query;
+	char	   *end;
+
+	initStringInfo(&sinfo);
+
+	appendBinaryStringInfo(&sinfo, query, vci->values);
+	appendStringInfoString(&sinfo, " SELECT ");
+
+	end = query + vci->end;
+	append_unnested_query(c, &sinfo, query + vci->start, end);
+
+	appendStringInfoString(&sinfo, " FROM ");
+	append_unnest_clause(c, &sinfo);
+
+	appendStringInfo(&sinfo, " WHERE __dbms_sql_u.__n BETWEEN $%d AND $%d",
+					 c->nvariables + 1, c->nvariables + 2);
+
+	/* append RETURNING clause or semicolon */
+	appendStringInfoString(&sinfo, end + 1);
+
+	return sinfo.data;
+}
+
+/*
+ * Builds query joined laterally to unnest(...) of bound arrays, so the
+ * query is evaluated for every used element of arrays by one execution.
+ * The number of element is returned as last column "array_index". Two
+ * additional parameters are numbers of first and last used element.
+ * The rows are sorted by number of element. Rows of one element are
+ * usually returned in order of the query (nested loop over unnest WITH
+ * ORDINALITY doesn't need sort), but it is not guaranteed.
+ */
+static char *
+bulk_query(CursorData *c)
+{
+	StringInfoData sinfo;
+	char	   *query = c->parsed_query;
+
+	initStringInfo(&sinfo);
+
+	appendStringInfoString(&sinfo,
+						   "SELECT __dbms_sql_q.*, __dbms_sql_u.__n::int AS array_index FROM ");
+	append_unnest_clause(c, &sinfo);
+	appendStringInfoString(&sinfo, " CROSS JOIN LATERAL (");
+	append_unnested_query(c, &sinfo, query, query + strlen(query));
+
+	/* new line ends possible line comment */
+	appendStringInfo(&sinfo,
+					 "\n) AS __dbms_sql_q WHERE __dbms_sql_u.__n BETWEEN $%d AND $%d"
+					 " ORDER BY __dbms_sql_u.__n",
+					 c->nvariables + 1, c->nvariables + 2);
+
+	return sinfo.data;
+}
+
+/*
+ * Returns numbers of first and last used element of bound arrays (like
+ * unnest WITH ORDINALITY numbers them). Only elements of shortest array,
+ * and only elements of all windows specified by bind_array can be used.
+ * When some array is NULL, then last is less than first.
+ */
+static void
+get_arrays_window(CursorData *c, int *first, int *last)
+{
+	int			max_index1 = -1;
+	int			min_index2 = -1;
+	ListCell   *lc;
+
+	*first = 1;
+	*last = PG_INT32_MAX;
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (!var->is_array)
+			continue;
+
+		/* no element of NULL array can be used */
+		if (var->isnull)
+			*last = 0;
+		else
+			*last = *last > var->nelems ? var->nelems : *last;
+
+		/* search do lowest common denominator */
+		if (var->index1 != -1)
+		{
+			if (max_index1 != -1)
+			{
+				max_index1 = max_index1 < var->index1 ? var->index1 : max_index1;
+				min_index2 = min_index2 > var->index2 ? var->index2 : min_index2;
+			}
+			else
+			{
+				max_index1 = var->index1;
+				min_index2 = var->index2;
+			}
+		}
+	}
+
+	if (max_index1 != -1)
+	{
+		*first = max_index1 > 1 ? max_index1 : 1;
+		*last = Min(*last, *first + (min_index2 - max_index1));
+	}
+}
+
+/*
+ * Returns prepared plan of cursor's query joined to bound arrays
+ */
+static SPIPlanPtr
+prepare_bulk_plan(CursorData *c, int nargs, Oid *types)
+{
+	int			cursor_options = get_cursor_options(c);
+
+	if (plan_is_usable(c->bulk_plan, nargs, types, cursor_options))
+		return c->bulk_plan->plan;
+
+	return get_plan(c, &c->bulk_plan, bulk_query(c), nargs, types,
+					cursor_options);
+}
+
+/*
+ * Append rows returned by last executed DML statement to the buffer of
+ * RETURNING INTO variables. The values are copied, so the tuptable can
+ * be released immediately.
+ */
+static void
+store_returning_rows(CursorData *c)
+{
+	MemoryContext oldcxt;
+	TupleDesc	tupdesc;
+	Datum	   *values;
+	bool	   *nulls;
+	int			natts;
+	uint64		i;
+	int			j;
+
+	if (!SPI_tuptable)
+		return;
+
+	tupdesc = SPI_tuptable->tupdesc;
+	natts = tupdesc->natts;
+
+	if (natts != list_length(c->returning_vars))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("number of RETURNING INTO variables is different than number of returned columns")));
+
+	oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
+
+	if (!c->returning_tupdesc)
+	{
+		c->returning_tupdesc = CreateTupleDescCopy(tupdesc);
+		c->returning_values = palloc0(sizeof(Datum *) * natts);
+		c->returning_nulls = palloc0(sizeof(bool *) * natts);
+	}
+
+	if (c->returning_rows + SPI_processed > c->returning_size)
+	{
+		uint64		newsize = Max(c->returning_size * 2, c->returning_rows + SPI_processed);
+
+		newsize = Max(newsize, 64);
+
+		for (j = 0; j < natts; j++)
+		{
+			if (c->returning_values[j])
+			{
+				c->returning_values[j] = repalloc(c->returning_values[j], sizeof(Datum) * newsize);
+				c->returning_nulls[j] = repalloc(c->returning_nulls[j], sizeof(bool) * newsize);
+			}
+			else
+			{
+				c->returning_values[j] = palloc(sizeof(Datum) * newsize);
+				c->returning_nulls[j] = palloc(sizeof(bool) * newsize);
+			}
+		}
+
+		c->returning_size = newsize;
+	}
+
+	values = palloc(sizeof(Datum) * natts);
+	nulls = palloc(sizeof(bool) * natts);
+
+	for (i = 0; i < SPI_processed; i++)
+	{
+		uint64		row = c->returning_rows + i;
+
+		heap_deform_tuple(SPI_tuptable->vals[i], tupdesc, values, nulls);
+
+		for (j = 0; j < natts; j++)
+		{
+			Form_pg_attribute att = TupleDescAttr(tupdesc, j);
+
+			c->returning_nulls[j][row] = nulls[j];
+			c->returning_values[j][row] = nulls[j] ? (Datum) 0 :
+				datumCopy(values[j], att->attbyval, att->attlen);
+		}
+	}
+
+	c->returning_rows += SPI_processed;
+
+	pfree(values);
+	pfree(nulls);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	SPI_freetuptable(SPI_tuptable);
+}
+
+/*
+ * Execute INSERT INTO ... VALUES statement with array variables as one
+ * INSERT INTO ... SELECT statement. The result should be same like
+ * execution of original statement for any element of arrays.
+ */
+static long
+execute_set_based_insert(CursorData *c)
+{
+	MemoryContext oldcxt;
+	Datum	   *values;
+	char	   *nulls;
+	Oid		   *types;
+	int			nargs = c->nvariables + 2;
+	int			first;
+	int			last;
+	long		result = 0;
+	ListCell   *lc;
+	int			i;
+
+	oldcxt = MemoryContextSwitchTo(c->result_cxt);
+
+	values = palloc(sizeof(Datum) * nargs);
+	nulls = palloc(sizeof(char) * nargs);
+	types = palloc(sizeof(Oid) * nargs);
+
+	i = 0;
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->typoid == InvalidOid)
+			ereport(ERROR,
+				    (errcode(ERRCODE_UNDEFINED_PARAMETER),
+				     errmsg("variable \"%s\" has not a value", var->refname)));
+
+		/* the expanded array is passed as read only */
+		values[i] = var_param_value(var);
+		nulls[i] = var->isnull ? 'n' : ' ';
+
+		types[i++] = var->typoid;
+	}
+
+	/* nothing is executed, when some array is NULL */
+	get_arrays_window(c, &first, &last);
+
+	if (last >= first)
+	{
+		SPIPlanPtr	plan;
+		int			rc;
+
+		values[i] = Int32GetDatum(first);
+		nulls[i] = ' ';
+		types[i++] = INT4OID;
+
+		values[i] = Int32GetDatum(last);
+		nulls[i] = ' ';
+		types[i++] = INT4OID;
+
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connact failed");
+
+		if (plan_is_usable(c->set_based_plan, nargs, types, 0))
+			plan = c->set_based_plan->plan;
+		else
+			plan = get_plan(c, &c->set_based_plan, set_based_insert_query(c),
+							nargs, types, 0);
+
+		rc = SPI_execute_plan(plan, values, nulls, false, 0);
+		if (rc < 0)
+			/* internal error */
+			elog(ERROR, "cannot to execute a query");
+
+		result = SPI_processed;
+
+		if (c->returning_vars)
+			store_returning_rows(c);
+
+		SPI_finish();
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(c->result_cxt);
+
+	return result;
+}
+
+#if PG_VERSION_NUM >= 140000
+
+#define DIRECT_LOAD_BATCH_ROWS		1000
+
+/*
+ * Raise an error, when direct load cannot be used for the statement
+ */
+static void
+direct_load_not_supported(const char *detail)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("statement cannot be executed by direct load"),
+			 errdetail("%s", detail)));
+}
+
+/*
+ * Returns oid of target relation of INSERT INTO ... VALUES statement.
+ * The relation is locked. The text of column list is returned by
+ * columns argument (or NULL, when the list is not used).
+ */
+static Oid
+get_direct_load_target(CursorData *c, char **columns)
+{
+	char	   *query = c->parsed_query;
+	char	   *ptr = query;
+	char	   *end = query + c->values_clause.values;
+	char	   *name_start = NULL;
+	char	   *name_end = NULL;
+	char	   *cols_start = NULL;
+	char	   *cols_end = NULL;
+	bool		expect_name = true;
+	enum
+	{
+		TARGET_INSERT,
+		TARGET_INTO,
+		TARGET_NAME,
+		TARGET_ALIAS,
+		TARGET_AFTER_ALIAS,
+		TARGET_COLUMNS,
+		TARGET_END
+	}			state = TARGET_INSERT;
+	List	   *names;
+
+	while (ptr && ptr < end)
+	{
+		char	   *start;
+		char	   *sep;
+		char	   *next_ptr;
+		size_t		len;
+		size_t		seplen;
+		TokenType	typ;
+
+		next_ptr = next_token(ptr, &start, &len, &typ, &sep, &seplen);
+
+		if (typ == TOKEN_SPACES || typ == TOKEN_COMMENT || typ == TOKEN_NONE ||
+			(typ == TOKEN_OTHER && isspace((unsigned char) *start)))
+		{
+			ptr = next_ptr;
+			continue;
+		}
+
+		/* OVERRIDING clause can follow table name, alias or column list */
+		if (((state == TARGET_NAME && !expect_name) ||
+			 state == TARGET_AFTER_ALIAS || state == TARGET_END) &&
+			is_keyword(typ, start, len, "overriding"))
+			direct_load_not_supported("The OVERRIDING clause is not supported.");
+
+		switch (state)
+		{
+			case TARGET_INSERT:
+				state = TARGET_INTO;
+				break;
+
+			case TARGET_INTO:
+				if (!is_keyword(typ, start, len, "into"))
+					direct_load_not_supported("The INTO keyword is missing.");
+				state = TARGET_NAME;
+				break;
+
+			case TARGET_NAME:
+				if (is_char(typ, start, '(') && !expect_name)
+				{
+					cols_start = next_ptr;
+					state = TARGET_COLUMNS;
+				}
+				else if (is_char(typ, start, '.') && !expect_name)
+					expect_name = true;
+				else if ((typ == TOKEN_IDENTIF || typ == TOKEN_QIDENTIF) && expect_name)
+				{
+					if (!name_start)
+						name_start = ptr;
+					name_end = next_ptr;
+					expect_name = false;
+				}
+				else if (is_keyword(typ, start, len, "as") && !expect_name)
+					state = TARGET_ALIAS;
+				else
+					direct_load_not_supported("The target of INSERT statement is not supported.");
+				break;
+
+			case TARGET_ALIAS:
+				if (typ == TOKEN_IDENTIF || typ == TOKEN_QIDENTIF)
+					state = TARGET_AFTER_ALIAS;
+				else
+					direct_load_not_supported("The target of INSERT statement is not supported.");
+				break;
+
+			case TARGET_AFTER_ALIAS:
+				if (is_char(typ, start, '('))
+				{
+					cols_start = next_ptr;
+					state = TARGET_COLUMNS;
+				}
+				else
+					direct_load_not_supported("The target of INSERT statement is not supported.");
+				break;
+
+			case TARGET_COLUMNS:
+				if (is_char(typ, start, ')'))
+				{
+					cols_end = ptr;
+					state = TARGET_END;
+				}
+				else if (is_char(typ, start, '('))
+					direct_load_not_supported("The target of INSERT statement is not supported.");
+				break;
+
+			case TARGET_END:
+				direct_load_not_supported("Only the list of columns can be used before VALUES clause.");
+				break;
+		}
+
+		ptr = next_ptr;
+	}
+
+	if (!name_start || state == TARGET_COLUMNS)
+		direct_load_not_supported("The target of INSERT statement is not supported.");
+
+	*columns = cols_start ? pnstrdup(cols_start, cols_end - cols_start) : NULL;
+
+#if PG_VERSION_NUM >= 160000
+
+	names = stringToQualifiedNameList(pnstrdup(name_start, name_end - name_start), NULL);
+
+#else
+
+	names = stringToQualifiedNameList(pnstrdup(name_start, name_end - name_start));
+
+#endif
+
+	return RangeVarGetRelid(makeRangeVarFromNameList(names), RowExclusiveLock, false);
+}
+
+/*
+ * Insert prepared tuples to relation and to its indexes.
+ */
+static void
+direct_load_flush(Relation rel,
+				  ResultRelInfo *resultRelInfo,
+				  EState *estate,
+				  BulkInsertState bistate,
+				  CommandId mycid,
+				  TupleTableSlot **slots,
+				  int nslots)
+{
+	int			i;
+
+	table_multi_insert(rel, slots, nslots, mycid, 0, bistate);
+
+	if (resultRelInfo->ri_NumIndices > 0)
+	{
+		for (i = 0; i < nslots; i++)
+		{
+			List	   *recheck;
+
+#if PG_VERSION_NUM >= 160000
+
+			recheck = ExecInsertIndexTuples(resultRelInfo, slots[i], estate,
+											false, false, NULL, NIL, false);
+
+#else
+
+			recheck = ExecInsertIndexTuples(resultRelInfo, slots[i], estate,
+											false, false, NULL, NIL);
+
+#endif
+
+			list_free(recheck);
+		}
+	}
+
+	/* the values of tuples are copied by table_multi_insert */
+	ResetPerTupleExprContext(estate);
+}
+
+/*
+ * Execute INSERT INTO ... VALUES statement with array variables without
+ * executor. The tuples are built from the elements of arrays, and they are
+ * inserted by table_multi_insert like COPY does. Tables with triggers,
+ * rules, row level security or with defaults of not listed columns
+ * (including defaults and constraints of domains) are refused, because
+ * these features require executor.
+ */
+static long
+execute_direct_load(CursorData *c)
+{
+	ValuesClauseInfo *vci = &c->values_clause;
+	MemoryContext oldcxt;
+	Relation	rel;
+	TupleDesc	tupdesc;
+	AclResult	aclresult;
+	EState	   *estate;
+	ResultRelInfo *resultRelInfo;
+	BulkInsertState bistate;
+	TupleTableSlot **slots;
+	VariableData **vars;
+	VariableData **attvars;
+	CastCacheEntry **casts;
+	CommandId	mycid;
+	char	   *columns;
+	char	   *ptr;
+	char	   *end;
+	List	   *varnos = NIL;
+	int			nitems;
+	int			first;
+	int			last;
+	int			nslots = 0;
+	long		result = 0;
+	ListCell   *lc;
+	int			i;
+	int			k;
+
+	if (!vci->only_variables)
+		direct_load_not_supported("Only bind variables can be used in VALUES clause.");
+
+	if (c->returning_vars)
+		direct_load_not_supported("The RETURNING clause is not supported.");
+
+	/* nothing can follow VALUES clause */
+	ptr = c->parsed_query + vci->end + 1;
+	while (ptr)
+	{
+		char	   *start;
+		char	   *sep;
+		size_t		len;
+		size_t		seplen;
+		TokenType	typ;
+
+		ptr = next_token(ptr, &start, &len, &typ, &sep, &seplen);
+
+		if (ptr &&
+			!(typ == TOKEN_SPACES || typ == TOKEN_COMMENT || typ == TOKEN_NONE ||
+			  (typ == TOKEN_OTHER && (isspace((unsigned char) *start) || *start == ';'))))
+			direct_load_not_supported("The RETURNING clause is not supported.");
+	}
+
+	oldcxt = MemoryContextSwitchTo(c->result_cxt);
+
+	vars = palloc0(sizeof(VariableData *) * (c->nvariables + 1));
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->typoid == InvalidOid)
+			ereport(ERROR,
+				    (errcode(ERRCODE_UNDEFINED_PARAMETER),
+				     errmsg("variable \"%s\" has not a value", var->refname)));
+
+		vars[var->varno] = var;
+	}
+
+	get_arrays_window(c, &first, &last);
+
+	/* cannot to read data from NULL array */
+	if (last < first)
+		goto done;
+
+	/* the values list contains only $n symbols separated by commas */
+	ptr = c->parsed_query + vci->start;
+	end = c->parsed_query + vci->end;
+
+	while (ptr < end)
+	{
+		if (*ptr++ == '$')
+		{
+			int			varno = 0;
+
+			while (isdigit((unsigned char) *ptr))
+				varno = varno * 10 + (*ptr++ - '0');
+
+			varnos = lappend_int(varnos, varno);
+		}
+	}
+
+	nitems = list_length(varnos);
+
+	rel = table_open(get_direct_load_target(c, &columns), NoLock);
+	tupdesc = RelationGetDescr(rel);
+
+	if (rel->rd_rel->relkind != RELKIND_RELATION)
+		direct_load_not_supported("Only ordinary tables are supported.");
+
+	if (rel->trigdesc)
+		direct_load_not_supported("Tables with triggers or foreign keys are not supported.");
+
+	if (rel->rd_rules)
+		direct_load_not_supported("Tables with rules are not supported.");
+
+	if (check_enable_rls(RelationGetRelid(rel), InvalidOid, false) == RLS_ENABLED)
+		direct_load_not_supported("Tables with row level security are not supported.");
+
+	/* assign variables to attributes */
+	attvars = palloc0(sizeof(VariableData *) * tupdesc->natts);
+
+	if (columns)
+	{
+		List	   *colnames;
+
+		if (!SplitIdentifierString(columns, ',', &colnames))
+			direct_load_not_supported("The list of columns is not supported.");
+
+		if (list_length(colnames) != nitems)
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("number of target columns is different than number of expressions")));
+
+		i = 0;
+		foreach(lc, colnames)
+		{
+			char	   *colname = (char *) lfirst(lc);
+			int			attno;
+
+			for (attno = 0; attno < tupdesc->natts; attno++)
+			{
+				Form_pg_attribute att = TupleDescAttr(tupdesc, attno);
+
+				if (!att->attisdropped && strcmp(NameStr(att->attname), colname) == 0)
+					break;
+			}
+
+			if (attno == tupdesc->natts)
+				ereport(ERROR,
+						(errcode(ERRCODE_UNDEFINED_COLUMN),
+						 errmsg("column \"%s\" of relation \"%s\" does not exist",
+								colname, RelationGetRelationName(rel))));
+
+			if (attvars[attno])
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_COLUMN),
+						 errmsg("column \"%s\" specified more than once", colname)));
+
+			attvars[attno] = vars[list_nth_int(varnos, i++)];
+		}
+	}
+	else
+	{
+		int			attno;
+
+		i = 0;
+		for (attno = 0; attno < tupdesc->natts && i < nitems; attno++)
+		{
+			if (!TupleDescAttr(tupdesc, attno)->attisdropped)
+				attvars[attno] = vars[list_nth_int(varnos, i++)];
+		}
+
+		if (i < nitems)
+			ereport(ERROR,
+					(errcode(ERRCODE_SYNTAX_ERROR),
+					 errmsg("INSERT has more expressions than target columns")));
+	}
+
+	/*
+	 * Like executor, when INSERT on table is not granted, then INSERT
+	 * on all target columns is required.
+	 */
+	aclresult = pg_class_aclcheck(RelationGetRelid(rel), GetUserId(), ACL_INSERT);
+	if (aclresult != ACLCHECK_OK)
+	{
+		for (i = 0; i < tupdesc->natts; i++)
+		{
+			if (attvars[i] &&
+				pg_attribute_aclcheck(RelationGetRelid(rel), i + 1,
+									  GetUserId(), ACL_INSERT) != ACLCHECK_OK)
+				break;
+		}
+
+		if (i < tupdesc->natts)
+			aclcheck_error(aclresult,
+						   get_relkind_objtype(rel->rd_rel->relkind),
+						   RelationGetRelationName(rel));
+	}
+
+	casts = palloc0(sizeof(CastCacheEntry *) * tupdesc->natts);
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		VariableData *var = attvars[i];
+
+		if (att->attisdropped)
+			continue;
+
+		if (att->attgenerated)
+			direct_load_not_supported("Tables with generated columns are not supported.");
+
+		if (!var)
+		{
+			/* defaults should be evaluated by executor */
+			if (att->atthasdef || att->attidentity)
+				direct_load_not_supported("Not listed columns cannot to have default values.");
+
+			/* NULL is coerced to domain, so its default and constraints are used */
+			if (get_typtype(att->atttypid) == TYPTYPE_DOMAIN &&
+				(get_typdefault(att->atttypid) || DomainHasConstraints(att->atttypid)))
+				direct_load_not_supported("Not listed columns cannot to be of domain type with default value or constraints.");
+
+			continue;
+		}
+
+		/* OVERRIDING clause is not supported, so the value cannot be used */
+		if (att->attidentity == ATTRIBUTE_IDENTITY_ALWAYS)
+			ereport(ERROR,
+					(errcode(ERRCODE_GENERATED_ALWAYS),
+					 errmsg("cannot insert a non-DEFAULT value into column \"%s\"",
+							NameStr(att->attname)),
+					 errdetail("Column \"%s\" is an identity column defined as GENERATED ALWAYS.",
+							   NameStr(att->attname))));
+
+		/* too long strings should be refused like by INSERT */
+		casts[i] = get_cast_cache_entry(att->atttypid,
+										att->atttypmod,
+										var->is_array ? var->typelemid : var->typoid,
+										false);
+	}
+
+	estate = CreateExecutorState();
+
+	/* the relation is not in range table, so range table index is zero */
+	resultRelInfo = makeNode(ResultRelInfo);
+	InitResultRelInfo(resultRelInfo, rel, 0, NULL, 0);
+	ExecOpenIndices(resultRelInfo, false);
+
+	bistate = GetBulkInsertState();
+	mycid = GetCurrentCommandId(true);
+
+	slots = palloc0(sizeof(TupleTableSlot *) * DIRECT_LOAD_BATCH_ROWS);
+
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	/* first and last are numbers of elements, k is an index to elems */
+	for (k = first - 1; k < last; k++)
+	{
+		TupleTableSlot *slot;
+
+		if (!slots[nslots])
+			slots[nslots] = table_slot_create(rel, NULL);
+
+		slot = ExecClearTuple(slots[nslots]);
+
+		/* casted values are released after flush */
+		MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+
+		for (i = 0; i < tupdesc->natts; i++)
+		{
+			VariableData *var = attvars[i];
+			Datum		value = (Datum) 0;
+			bool		isnull = true;
+
+			if (var && var->is_array)
+			{
+				value = var->elems[k];
+				isnull = var->elemnulls && var->elemnulls[k];
+			}
+			else if (var)
+			{
+				value = var->value;
+				isnull = var->isnull;
+			}
+
+			if (var)
+				value = cast_value(casts[i], value, isnull);
+
+			slot->tts_values[i] = value;
+			slot->tts_isnull[i] = isnull;
+		}
+
+		MemoryContextSwitchTo(c->result_cxt);
+
+		ExecStoreVirtualTuple(slot);
+
+		if (tupdesc->constr)
+			ExecConstraints(resultRelInfo, slot, estate);
+
+		if (rel->rd_rel->relispartition)
+			ExecPartitionCheck(resultRelInfo, slot, estate, true);
+
+		if (++nslots == DIRECT_LOAD_BATCH_ROWS)
+		{
+			direct_load_flush(rel, resultRelInfo, estate, bistate, mycid,
+							  slots, nslots);
+			nslots = 0;
+		}
+
+		result += 1;
+	}
+
+	if (nslots > 0)
+		direct_load_flush(rel, resultRelInfo, estate, bistate, mycid,
+						  slots, nslots);
+
+	PopActiveSnapshot();
+
+	FreeBulkInsertState(bistate);
+	table_finish_bulk_insert(rel, 0);
+
+	for (i = 0; i < DIRECT_LOAD_BATCH_ROWS && slots[i]; i++)
+		ExecDropSingleTupleTableSlot(slots[i]);
+
+	ExecCloseIndices(resultRelInfo);
+	FreeExecutorState(estate);
+
+	table_close(rel, NoLock);
+
+	/* inserted rows should be visible for next statements */
+	CommandCounterIncrement();
+
+done:
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextReset(c->result_cxt);
+
+	return result;
+}
+
+#else
+
+static long
+execute_direct_load(CursorData *c)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("direct load requires PostgreSQL 14 or higher")));
+
+	return 0L;
+}
+
+#endif
+
+/*
+ * Prepare target tuple descriptor from defined columns. It is used for
+ * final tupconversion of fetched rows.
+ */
+static void
+prepare_result_columns(CursorData *c)
+{
+	MemoryContext oldcxt;
+	int			batch_rows = -1;
+	int			i;
+
+	oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
+
+#if PG_VERSION_NUM >= 120000
+
+	c->coltupdesc = CreateTemplateTupleDesc(c->max_colpos);
+
+#else
+
+	c->coltupdesc = CreateTemplateTupleDesc(c->max_colpos, false);
+
+#endif
+
+	/* prepare current result column tupdesc */
+	for (i = 1; i <= c->max_colpos; i++)
+	{
+		ColumnData *col = get_col(c, i, false);
+		char genname[32];
+
+		snprintf(genname, 32, "col%d", i);
+
+		if (col->typarrayoid)
+		{
+			if (batch_rows != -1)
+				batch_rows = batch_rows > col->rowcount ? col->rowcount : batch_rows;
+			else
+				batch_rows = col->rowcount;
+
+			c->array_columns = bms_add_member(c->array_columns, i);
+
+			/* accumulated rows are written again from lower_bnd */
+			col->next_index = col->index1;
+		}
+		else
+		{
+			/* in this case we cannot do batch of rows */
+			batch_rows = 1;
+		}
+
+		TupleDescInitEntry(c->coltupdesc, (AttrNumber) i, genname, col->typoid, col->typmod, 0);
+	}
+
+	c->batch_rows = batch_rows;
+	c->casts = palloc0(sizeof(CastCacheData) * c->coltupdesc->natts);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Raise an error, when number of columns of result is different than
+ * number of defined columns.
+ */
+static void
+check_result_columns(CursorData *c, TupleDesc tupdesc)
+{
+	int			natts = 0;
+	int			i;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped)
+			continue;
+
+		natts += 1;
+	}
+
+	if (natts != c->coltupdesc->natts)
+		ereport(ERROR,
+			    (errcode(ERRCODE_DATA_EXCEPTION),
+			     errmsg("number of defined columns is different than number of query's columns")));
+}
+
+/*
+ * Returns true, when the plan is plain query, that can be executed by
+ * portal and passed as refcursor. The data modifying statements (including
+ * queries with data modifying CTE) are executed by execute immediately.
+ */
+static bool
+is_query_plan(SPIPlanPtr plan)
+{
+	CachedPlanSource *plansource;
+	Query	   *query;
+
+	if (!SPI_is_cursor_plan(plan) || list_length(plan->plancache_list) != 1)
+		return false;
+
+	plansource = (CachedPlanSource *) linitial(plan->plancache_list);
+	if (list_length(plansource->query_list) != 1)
+		return false;
+
+	query = (Query *) linitial(plansource->query_list);
+
+	return query->commandType == CMD_SELECT && !query->hasModifyingCTE;
+}
+
+#if PG_VERSION_NUM >= 140000
+
+/*
+ * Receiver of rows of parallel query. The rows are stored to tuptable
+ * like by SPI, but the memory limit is checked while the rows are read,
+ * and not only after execution.
+ */
+typedef struct
+{
+	DestReceiver pub;
+	SPITupleTable *tuptable;
+} DrainReceiver;
+
+#define DRAIN_MEMORY_CHECK_ROWS		1000
+
+static void
+drain_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	SPITupleTable *tuptable = ((DrainReceiver *) self)->tuptable;
+	MemoryContext oldcxt;
+
+	oldcxt = MemoryContextSwitchTo(tuptable->tuptabcxt);
+
+	tuptable->tupdesc = CreateTupleDescCopy(typeinfo);
+	tuptable->alloced = 128;
+	tuptable->vals = palloc(sizeof(HeapTuple) * tuptable->alloced);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+static bool
+drain_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	SPITupleTable *tuptable = ((DrainReceiver *) self)->tuptable;
+	MemoryContext oldcxt;
+	HeapTuple	tuple;
+
+	oldcxt = MemoryContextSwitchTo(tuptable->tuptabcxt);
+
+	if (tuptable->numvals >= tuptable->alloced)
+	{
+		tuptable->alloced *= 2;
+		tuptable->vals = repalloc_huge(tuptable->vals,
+									   sizeof(HeapTuple) * tuptable->alloced);
+	}
+
+	tuple = ExecCopySlotHeapTuple(slot);
+	tuptable->vals[tuptable->numvals++] = tuple;
+
+	MemoryContextSwitchTo(oldcxt);
+
+	if (max_memory > 0)
+	{
+		add_memory_usage_estimate(HEAPTUPLESIZE + tuple->t_len);
+
+		if (tuptable->numvals % DRAIN_MEMORY_CHECK_ROWS == 0)
+			check_memory_limit();
+	}
+
+	return true;
+}
+
+static void
+drain_shutdown(DestReceiver *self)
+{
+	/* nothing to do */
+}
+
+static void
+drain_destroy(DestReceiver *self)
+{
+	/* receiver is allocated on stack */
+}
+
+/*
+ * Reads all rows of parallel query to new tuptable allocated in
+ * cursor's transaction context.
+ */
+static SPITupleTable *
+drain_query(CursorData *c, SPIPlanPtr plan, int nargs,
+			Oid *types, Datum *values, char *nulls)
+{
+	DrainReceiver receiver;
+	SPITupleTable *tuptable;
+	ParamListInfo params;
+	MemoryContext tuptabcxt;
+	int			rc;
+	int			i;
+
+	tuptabcxt = AllocSetContextCreate(c->cursor_xact_cxt,
+									  "dbms_sql drained rows context",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	tuptable = MemoryContextAllocZero(tuptabcxt, sizeof(SPITupleTable));
+	tuptable->tuptabcxt = tuptabcxt;
+
+	/* the parameters are passed like by SPI_execute_plan */
+	params = makeParamList(nargs);
+
+	for (i = 0; i < nargs; i++)
+	{
+		ParamExternData *prm = &params->params[i];
+
+		prm->value = values[i];
+		prm->isnull = nulls[i] == 'n';
+		prm->pflags = PARAM_FLAG_CONST;
+		prm->ptype = types[i];
+	}
+
+	receiver.pub.receiveSlot = drain_receive;
+	receiver.pub.rStartup = drain_startup;
+	receiver.pub.rShutdown = drain_shutdown;
+	receiver.pub.rDestroy = drain_destroy;
+	receiver.pub.mydest = DestNone;
+	receiver.tuptable = tuptable;
+
+	rc = SPI_execute_plan_with_receiver(plan, params, false, 0, &receiver.pub);
+	if (rc < 0)
+		/* internal error */
+		elog(ERROR, "cannot to execute a query");
+
+	/* the receiver is started only for statements that returns rows */
+	if (!tuptable->tupdesc)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("statement doesn't return rows")));
+
+	return tuptable;
+}
+
+#endif
+
+static long
+execute_statement(CursorData *c, bool open_query)
+{
+	last_row_count = 0;
+
+	/* clean space with saved result */
+	reset_cursor_xact_cxt(c);
+
+	c->result_cxt = AllocSetContextCreate(c->cursor_xact_cxt,
+										  "dbms_sql short life context",
+										  ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * When column definitions are available, build final query
+	 * and open cursor for fetching. When column definitions are
+	 * missing, then the statement can be called with high frequency
+	 * etc INSERT, UPDATE, so use cached plan. The query without defined
+	 * columns is opened by portal only for to_refcursor.
+	 */
+	if (c->columns || open_query)
+	{
+		Datum	   *values;
+		Oid		   *types;
+		char *nulls;
+		ListCell   *lc;
+		int		i;
+		int			nargs = c->nvariables;
+		bool		has_arrays = false;
+		SPIPlanPtr	plan;
+		MemoryContext oldcxt;
+		TupleDesc	result_tupdesc;
+
+		oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
+
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			if (var->is_array)
+			{
+				/* query is joined to the elements of arrays */
+				has_arrays = true;
+				nargs = c->nvariables + 2;
+				break;
+			}
+		}
+
+		/* prepare query arguments */
+		values = palloc(sizeof(Datum) * nargs);
+		types = palloc(sizeof(Oid) * nargs);
+		nulls = palloc(sizeof(char) * nargs);
+
+		i = 0;
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			/* the parameters are copied to portal by SPI_cursor_open */
+			if (!var->isnull)
+			{
+				values[i] = var_param_value(var);
+				nulls[i] = ' ';
+			}
+			else
+				nulls[i] = 'n';
+
+			if (var->typoid == InvalidOid)
+				ereport(ERROR,
+					    (errcode(ERRCODE_UNDEFINED_PARAMETER),
+					     errmsg("variable \"%s\" has not a value", var->refname)));
+
+			types[i] = var->typoid;
+			i += 1;
+		}
+
+		if (has_arrays)
+		{
+			int			first;
+			int			last;
+
+			get_arrays_window(c, &first, &last);
+
+			values[i] = Int32GetDatum(first);
+			nulls[i] = ' ';
+			types[i++] = INT4OID;
+
+			values[i] = Int32GetDatum(last);
+			nulls[i] = ' ';
+			types[i++] = INT4OID;
+		}
+
+		/* descriptor of fetched rows is owned by tuples context */
+		c->tupdesc = NULL;
+
+		if (c->columns)
+			prepare_result_columns(c);
+
+		MemoryContextSwitchTo(oldcxt);
+
+		/* the name is unique, so the portal can be passed as refcursor */
+		snprintf(c->cursorname, sizeof(c->cursorname), "__orafce_dbms_sql_cursor_%d_%u",
+				 c->cid, ++portal_counter);
+
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connact failed");
+
+		if (has_arrays)
+			plan = prepare_bulk_plan(c, nargs, types);
+		else
+			plan = prepare_plan(c, types);
+
+		/* only plain query can be passed as refcursor */
+		if (!c->columns && !is_query_plan(plan))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_CURSOR_STATE),
+					 errmsg("statement is not a query"),
+					 errhint("Only SELECT statement can be passed as refcursor.")));
+
+		if (c->parallel)
+		{
+			/*
+			 * Parallel plan can be used only when the query is executed
+			 * to the end by one run of executor. So the query is not
+			 * executed by portal, all rows are read now and they are
+			 * returned by following fetches.
+			 */
+#if PG_VERSION_NUM >= 140000
+
+			c->drained_tuptable = drain_query(c, plan, nargs, types, values, nulls);
+			c->drained_rows = c->drained_tuptable->numvals;
+
+#else
+
+			int			rc;
+
+			/* the memory limit is checked only after execution */
+			rc = SPI_execute_plan(plan, values, nulls, false, 0);
+			if (rc < 0)
+				/* internal error */
+				elog(ERROR, "cannot to execute a query");
+
+			if (SPI_tuptable == NULL)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("statement doesn't return rows")));
+
+			MemoryContextSetParent(SPI_tuptable->tuptabcxt, c->cursor_xact_cxt);
+			c->drained_tuptable = SPI_tuptable;
+			c->drained_rows = SPI_processed;
+
+#endif
+
+			result_tupdesc = c->drained_tuptable->tupdesc;
+		}
+		else
+		{
+			c->portal = SPI_cursor_open(c->cursorname,
+										plan,
+										values,
+										nulls,
+										false);
+
+			/* internal error */
+			if (c->portal == NULL)
+				elog(ERROR,
+					 "could not open cursor for query \"%s\": %s",
+					 c->parsed_query,
+					 SPI_result_code_string(SPI_result));
+
+			result_tupdesc = c->portal->tupDesc;
+		}
+
+		SPI_finish();
+
+		if (result_tupdesc && c->columns)
+			check_result_columns(c, result_tupdesc);
+
+		c->executed = true;
+	}
+	else
+	{
+		MemoryContext oldcxt;
+		Datum	   *values;
+		char	   *nulls;
+		Oid		   *types;
+		VariableData **arrays;
+		bool		has_iterator = false;
+		bool		has_value = true;
+		int			max_index1 = -1;
+		int			min_index2 = -1;
+		int			max_rows = -1;
+		long		result = 0;
+		SPIPlanPtr	plan;
+		ListCell   *lc;
+		int			i;
+
+		if (c->direct_load && c->values_clause.values != -1)
+		{
+			foreach(lc, c->variables)
+			{
+				VariableData *var = (VariableData *) lfirst(lc);
+
+				if (var->is_array)
+					return execute_direct_load(c);
+			}
+		}
+
+		if (use_set_based_insert(c))
+			return execute_set_based_insert(c);
+
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connact failed");
+
+		/* prepare, or reuse cached plan */
+		types = palloc(sizeof(Oid) * c->nvariables);
+
+		i = 0;
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			if (var->typoid == InvalidOid)
+				ereport(ERROR,
+					    (errcode(ERRCODE_UNDEFINED_PARAMETER),
+					     errmsg("variable \"%s\" has not a value", var->refname)));
+
+			types[i++] = var->is_array ? var->typelemid : var->typoid;
+		}
+
+		plan = prepare_plan(c, types);
+
+		pfree(types);
+
+		oldcxt = MemoryContextSwitchTo(c->result_cxt);
+
+		/* prepare query arguments */
+		values = palloc(sizeof(Datum) * c->nvariables);
+		nulls = palloc(sizeof(char) * c->nvariables);
+		arrays = palloc0(sizeof(VariableData *) * c->nvariables);
+
+		has_value = true;
+
+		i = 0;
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			if (var->is_array)
+			{
+				if (!var->isnull)
+				{
+					/* elements are read from element cache of variable */
+					arrays[i] = var;
+
+					/* search do lowest common denominator */
+					if (var->index1 != -1)
+					{
+						if (max_index1 != -1)
+						{
+							max_index1 = max_index1 < var->index1 ? var->index1 : max_index1;
+							min_index2 = min_index2 > var->index2 ? var->index2 : min_index2;
+						}
+						else
+						{
+							max_index1 = var->index1;
+							min_index2 = var->index2;
+						}
+					}
+
+					has_iterator = true;
+				}
+				else
+				{
+					/* cannot to read data from NULL array */
+					has_value = false;
+					break;
+				}
+			}
+			else
+			{
+				values[i] = var_param_value(var);
+				nulls[i] = var->isnull ? 'n' : ' ';
+			}
+
+			i += 1;
+		}
+
+		if (has_iterator)
+		{
+			if (has_value)
+			{
+				int			first = 0;
+				int			last = PG_INT32_MAX;
+				int			k;
+
+				if (max_index1 != -1)
+				{
+					max_rows = min_index2 - max_index1 + 1;
+					first = max_index1 > 1 ? max_index1 - 1 : 0;
+				}
+
+				/* only elements of shortest array can be used */
+				for (i = 0; i < c->nvariables; i++)
+				{
+					if (arrays[i] && arrays[i]->nelems < last)
+						last = arrays[i]->nelems;
+				}
+
+				if (max_rows != -1 && first + max_rows < last)
+					last = first + max_rows;
+
+				for (k = first; k < last; k++)
+				{
+					int			rc;
+
+					for (i = 0; i < c->nvariables; i++)
+					{
+						if (arrays[i])
+						{
+							values[i] = arrays[i]->elems[k];
+							nulls[i] = arrays[i]->elemnulls && arrays[i]->elemnulls[k] ? 'n' : ' ';
+						}
+					}
+
+					rc = SPI_execute_plan(plan, values, nulls, false, 0);
+					if (rc < 0)
+						/* internal error */
+						elog(ERROR, "cannot to execute a query");
+
+					result += SPI_processed;
+
+					if (c->returning_vars)
+						store_returning_rows(c);
+				}
+			}
+
+			MemoryContextReset(c->result_cxt);
+		}
+		else
+		{
+			int			rc;
+
+			rc = SPI_execute_plan(plan, values, nulls, false, 0);
+			if (rc < 0)
+				/* internal error */
+				elog(ERROR, "cannot to execute a query");
+
+			result = SPI_processed;
+
+			if (c->returning_vars)
+				store_returning_rows(c);
+		}
+
+		SPI_finish();
+
+		MemoryContextSwitchTo(oldcxt);
+
+		return result;
+	}
+
+	return 0L;
+}
+
+/*
+ * Returns statement, that is executed by cursor, and its arguments. The
+ * statements with array variables are rewritten like by execution. When
+ * the statement is executed row by row, then the values of first used
+ * elements are used.
+ */
+static char *
+get_executed_query(CursorData *c, int *nargs, Oid **types, Datum **values, char **nulls)
+{
+	char	   *query = c->parsed_query;
+	bool		has_arrays = false;
+	bool		rewritten = false;
+	int			first;
+	int			last;
+	ListCell   *lc;
+	int			i;
+
+	if (!query)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_CURSOR_STATE),
+				 errmsg("cursor is not parsed")));
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->typoid == InvalidOid)
+			ereport(ERROR,
+				    (errcode(ERRCODE_UNDEFINED_PARAMETER),
+				     errmsg("variable \"%s\" has not a value", var->refname)));
+
+		if (var->is_array)
+			has_arrays = true;
+	}
+
+	get_arrays_window(c, &first, &last);
+
+	if (has_arrays)
+	{
+		if (c->columns)
+		{
+			query = bulk_query(c);
+			rewritten = true;
+		}
+		else if (c->values_clause.values != -1 && c->direct_load)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("statement executed by direct load has not a plan")));
+		else if (use_set_based_insert(c))
+		{
+			query = set_based_insert_query(c);
+			rewritten = true;
+		}
+	}
+
+	*nargs = rewritten ? c->nvariables + 2 : c->nvariables;
+	*types = palloc(sizeof(Oid) * (*nargs + 1));
+	*values = palloc(sizeof(Datum) * (*nargs + 1));
+	*nulls = palloc(sizeof(char) * (*nargs + 1));
+
+	i = 0;
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->is_array && !rewritten)
+		{
+			/* value of first used element */
+			(*types)[i] = var->typelemid;
+
+			if (first <= last && first <= var->nelems &&
+				!(var->elemnulls && var->elemnulls[first - 1]))
+			{
+				(*values)[i] = var->elems[first - 1];
+				(*nulls)[i] = ' ';
+			}
+			else
+				(*nulls)[i] = 'n';
+		}
+		else
+		{
+			(*types)[i] = var->typoid;
+			(*values)[i] = var_param_value(var);
+			(*nulls)[i] = var->isnull ? 'n' : ' ';
+		}
+
+		i += 1;
+	}
+
+	if (rewritten)
+	{
+		(*types)[i] = INT4OID;
+		(*values)[i] = Int32GetDatum(first);
+		(*nulls)[i++] = ' ';
+
+		(*types)[i] = INT4OID;
+		(*values)[i] = Int32GetDatum(last);
+		(*nulls)[i++] = ' ';
+	}
+
+	return query;
+}
+
+/*
+ * Returns list of lines of EXPLAIN of statement executed by cursor. The
+ * current values of bind variables are used for planning. The lines are
+ * allocated in current memory context.
+ */
+static List *
+explain_cursor(CursorData *c, bool analyze)
+{
+	MemoryContext	callercxt = CurrentMemoryContext;
+	StringInfoData	sinfo;
+	List	   *result = NIL;
+	char	   *query;
+	Oid		   *types;
+	Datum	   *values;
+	char	   *nulls;
+	int			nargs;
+	int			save_nestlevel = 0;
+	uint64		i;
+	int			rc;
+
+	query = get_executed_query(c, &nargs, &types, &values, &nulls);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connact failed");
+
+	/* EXPLAIN ANALYZE executes the statement, so DML statements are refused */
+	if (analyze)
+	{
+		SPIPlanPtr	plan;
+		bool		is_query;
+
+		plan = SPI_prepare(query, nargs, types);
+		if (!plan)
+			/* internal error */
+			elog(ERROR, "cannot to prepare a query");
+
+		is_query = is_query_plan(plan);
+		SPI_freeplan(plan);
+
+		if (!is_query)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("EXPLAIN ANALYZE of data modifying statement is not supported"),
+					 errdetail("EXPLAIN ANALYZE executes the statement.")));
+	}
+
+	initStringInfo(&sinfo);
+	appendStringInfo(&sinfo, "EXPLAIN (ANALYZE %s) %s",
+					 analyze ? "true" : "false", query);
+
+	/*
+	 * EXPLAIN allows parallel plans always, but the cursor can use them
+	 * only when parallel execution is enabled by set_parallel.
+	 */
+	if (!(get_cursor_options(c) & CURSOR_OPT_PARALLEL_OK))
+	{
+		save_nestlevel = NewGUCNestLevel();
+		(void) set_config_option("max_parallel_workers_per_gather", "0",
+								 PGC_USERSET, PGC_S_SESSION,
+								 GUC_ACTION_SAVE, true, 0, false);
+	}
+
+	rc = SPI_execute_with_args(sinfo.data, nargs, types, values, nulls, false, 0);
+	if (rc < 0 || !SPI_tuptable)
+		/* internal error */
+		elog(ERROR, "cannot to explain a query");
+
+	if (save_nestlevel > 0)
+		AtEOXact_GUC(true, save_nestlevel);
+
+	for (i = 0; i < SPI_processed; i++)
+	{
+		char	   *line = SPI_getvalue(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1);
+
+		result = lappend(result, MemoryContextStrdup(callercxt, line));
+	}
+
+	SPI_finish();
+
+	return result;
+}
+
+#define LOG_BIND_VALUE_MAX_LENGTH	64
+
+/*
+ * Writes list of bind variables and their values to sinfo. Long
+ * values are shortened.
+ */
+static void
+append_bind_values(CursorData *c, StringInfo sinfo)
+{
+	ListCell   *lc;
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (lc != list_head(c->variables))
+			appendStringInfoString(sinfo, ", ");
+
+		appendStringInfo(sinfo, ":%s = ", var->refname);
+
+		if (var->typoid == InvalidOid)
+			appendStringInfoString(sinfo, "not assigned");
+		else if (var->is_array && !var->isnull)
+		{
+			/* whole arrays can be too long, so only size is displayed */
+			if (var->index1 != -1)
+				appendStringInfo(sinfo, "array of %d elements [%d:%d]",
+								 var->nelems, var->index1, var->index2);
+			else
+				appendStringInfo(sinfo, "array of %d elements", var->nelems);
+		}
+		else if (!var->isnull)
+		{
+			Oid		typOutput;
+			bool	isVarlena;
+			char   *str;
+			int		fulllen;
+			int		len;
+
+			getTypeOutputInfo(var->typoid, &typOutput, &isVarlena);
+			str = OidOutputFunctionCall(typOutput, var->value);
+
+			fulllen = len = strlen(str);
+			if (len > LOG_BIND_VALUE_MAX_LENGTH)
+				len = pg_mbcliplen(str, len, LOG_BIND_VALUE_MAX_LENGTH);
+
+			appendStringInfoCharMacro(sinfo, '\'');
+			appendBinaryStringInfo(sinfo, str, len);
+			appendStringInfoString(sinfo, len < fulllen ? "...'" : "'");
+		}
+		else
+			appendStringInfoString(sinfo, "NULL");
+	}
+}
+
+/*
+ * Returns EXPLAIN of statement for log, or NIL, when the plan cannot
+ * be displayed. The logging should not to raise an error, so EXPLAIN is
+ * executed inside subtransaction, and its error is ignored.
+ */
+static List *
+log_explain_cursor(CursorData *c)
+{
+	MemoryContext oldcxt = CurrentMemoryContext;
+	ResourceOwner oldowner = CurrentResourceOwner;
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	/* cursors opened by to_cursor_number have not parsed query */
+	if (!c->parsed_query || c->direct_load)
+		return NIL;
+
+	foreach(lc, c->variables)
+	{
+		VariableData *var = (VariableData *) lfirst(lc);
+
+		if (var->typoid == InvalidOid)
+			return NIL;
+	}
+
+	BeginInternalSubTransaction(NULL);
+	MemoryContextSwitchTo(oldcxt);
+
+	PG_TRY();
+	{
+		result = explain_cursor(c, false);
+
+		ReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcxt);
+		CurrentResourceOwner = oldowner;
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(oldcxt);
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcxt);
+		CurrentResourceOwner = oldowner;
+
+		result = NIL;
+	}
+	PG_END_TRY();
+
+	return result;
+}
+
+/*
+ * Adds elapsed time to the time of sequence of execute and fetches.
+ * When the time exceeds dbms_sql.log_min_duration, then the statement,
+ * values of bind variables and plan are logged. The sequence is logged
+ * only once.
+ */
+static void
+log_slow_statement(CursorData *c, double elapsed, bool is_fetch)
+{
+	StringInfoData sinfo;
+	List	   *plan;
+	ListCell   *lc;
+
+	c->log_duration += elapsed;
+	if (is_fetch)
+		c->log_fetches += 1;
+
+	if (log_min_duration < 0 || c->log_logged ||
+		c->log_duration < (double) log_min_duration)
+		return;
+
+	c->log_logged = true;
+
+	initStringInfo(&sinfo);
+
+	append_bind_values(c, &sinfo);
+
+	plan = log_explain_cursor(c);
+	if (plan)
+	{
+		/* the executed plan is not available, the statement is planned again */
+		appendStringInfoString(&sinfo, "\nPlan (planned again with current values):");
+		foreach(lc, plan)
+			appendStringInfo(&sinfo, "\n%s", (char *) lfirst(lc));
+	}
+	else
+		appendStringInfoString(&sinfo, "\nPlan is not available.");
+
+	ereport(LOG,
+			(errmsg("duration: %.3f ms  dbms_sql execute and %d fetches of cursor %d: %s",
+					c->log_duration, c->log_fetches, c->cid,
+					c->original_query ? c->original_query : c->parsed_query),
+			 errdetail_log("Bind variables: %s", sinfo.data),
+			 errhidestmt(true)));
+
+	list_free_deep(plan);
+	pfree(sinfo.data);
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.explain(c int, analyze bool DEFAULT false) RETURNS SETOF text;
+ */
+Datum
+dbms_sql_explain(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	List	   *lines;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		CursorData *c;
+		MemoryContext oldcxt;
+		bool		analyze;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+
+		c = get_cursor(fcinfo, true);
+		analyze = !PG_ARGISNULL(1) && PG_GETARG_BOOL(1);
+
+		oldcxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+		funcctx->user_fctx = explain_cursor(c, analyze);
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	funcctx = SRF_PERCALL_SETUP();
+	lines = (List *) funcctx->user_fctx;
+
+	if (funcctx->call_cntr < (uint64) list_length(lines))
+	{
+		char	   *line = (char *) list_nth(lines, (int) funcctx->call_cntr);
+
+		SRF_RETURN_NEXT(funcctx, CStringGetTextDatum(line));
+	}
+
+	SRF_RETURN_DONE(funcctx);
+}
+
+static long
+execute(CursorData *c, bool open_query)
+{
+	instr_time	start_time;
+	long		result;
+	double		elapsed = 0.0;
+	int64		array_size = 0;
+	ListCell   *lc;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	result = execute_statement(c, open_query);
+
+	reset_memory_usage_estimate();
+	check_memory_limit();
+
+	c->stats.execute_calls += 1;
+	c->stats.rows_processed += result;
+	add_elapsed_time(&elapsed, start_time);
+	c->stats.execute_time += elapsed;
+
+	/* new sequence of execute and fetches */
+	c->log_duration = 0.0;
+	c->log_fetches = 0;
+	c->log_logged = false;
+
+	if (log_min_duration >= 0)
+		log_slow_statement(c, elapsed, false);
+
+	if (statements_hash)
+	{
+		/* only elements of shortest array are used */
+		foreach(lc, c->variables)
+		{
+			VariableData *var = (VariableData *) lfirst(lc);
+
+			if (var->is_array && !var->isnull &&
+				(array_size == 0 || var->nelems < array_size))
+				array_size = var->nelems;
+		}
+
+		statement_stats_store(c, false, elapsed, result, array_size);
+	}
+
+	return result;
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.execute(c int) RETURNS bigint;
+ */
+Datum
+dbms_sql_execute(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+
+	c = get_cursor(fcinfo, true);
+
+	PG_RETURN_INT64(execute(c, false));
+}
+
+/*
+ * Returns number of rows that should be fetched from portal. The number
+ * is reduced for wide rows, so size of fetched rows should not be higher
+ * than dbms_sql.prefetch_bytes, and the memory used by dbms_sql should not
+ * be higher than dbms_sql.max_memory. When the result is fetched to arrays, then
+ * the number of rows is multiple of array's batch size.
+ */
+static int
+get_prefetch_rows(CursorData *c)
+{
+	int			rows;
+
+	rows = c->prefetch_rows > 0 ? c->prefetch_rows : prefetch_rows;
+
+	if (prefetch_bytes > 0 && c->avg_tuple_width > 0)
+	{
+		double		max_rows = (double) prefetch_bytes * 1024.0 / c->avg_tuple_width;
+
+		if (max_rows < rows)
+			rows = max_rows > 1.0 ? (int) max_rows : 1;
+	}
+
+	/* fetched rows should not exceed dbms_sql.max_memory */
+	if (max_memory > 0 && c->avg_tuple_width > 0)
+	{
+		double		available = (double) max_memory * 1024.0 - get_memory_usage_estimate();
+		double		max_rows = available / c->avg_tuple_width;
+
+		if (max_rows < rows)
+			rows = max_rows > 1.0 ? (int) max_rows : 1;
+	}
+
+	if (c->array_columns)
+	{
+		if (rows > c->batch_rows)
+			rows = (rows / c->batch_rows) * c->batch_rows;
+		else
+			rows = c->batch_rows;
+	}
+
+	return rows;
+}
+
+/*
+ * Deform all fetched rows to column vectors. The value of column pos
+ * of row idx is on position (pos - 1) * processed + idx. Values of
+ * varlena types point to fetched rows.
+ */
+static void
+deform_tuples(CursorData *c, uint64 processed)
+{
+	MemoryContext oldcxt;
+	int			natts = c->tupdesc->natts;
+	Datum	   *values;
+	bool	   *nulls;
+	uint64		i;
+	int			j;
+
+	c->colvalues = NULL;
+	c->colnulls = NULL;
+
+	if (processed == 0 || natts == 0)
+		return;
+
+	oldcxt = MemoryContextSwitchTo(c->tuples_cxt);
+
+	c->colvalues = palloc(sizeof(Datum) * natts * processed);
+	c->colnulls = palloc(sizeof(bool) * natts * processed);
+
+	values = palloc(sizeof(Datum) * natts);
+	nulls = palloc(sizeof(bool) * natts);
+
+	for (i = 0; i < processed; i++)
+	{
+		heap_deform_tuple(c->tuples[i], c->tupdesc, values, nulls);
+
+		for (j = 0; j < natts; j++)
+		{
+			c->colvalues[j * processed + i] = values[j];
+			c->colnulls[j * processed + i] = nulls[j];
+		}
+	}
+
+	pfree(values);
+	pfree(nulls);
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Fetch next batch of rows from cursor's portal. Previously fetched
+ * rows are released.
+ */
+static void
+fetch_batch(CursorData *c, bool exact)
+{
+	uint64		processed;
+	uint64		i;
+	uint64		width = 0;
+	int			batch_rows;
+	instr_time	start_time;
+	double		elapsed = 0.0;
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	/* create or reset context for tuples */
+	if (!c->tuples_cxt)
+		c->tuples_cxt = AllocSetContextCreate(c->cursor_xact_cxt,
+											  "dbms_sql tuples context",
+											  ALLOCSET_DEFAULT_SIZES);
+	else
+		MemoryContextReset(c->tuples_cxt);
+
+	if (!exact)
+		batch_rows = get_prefetch_rows(c);
+	else
+		batch_rows = 2;
+
+	if (c->drained_tuptable)
+	{
+		/*
+		 * All rows was read by execute, they are returned by first fetch.
+		 * Next fetches returns no rows.
+		 */
+		c->tupdesc = c->drained_tuptable->tupdesc;
+		c->tuples = c->drained_tuptable->vals;
+		processed = c->drained_rows;
+		c->drained_rows = 0;
+	}
+	else
+	{
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "SPI_connact failed");
+
+		/* try to fetch data from cursor */
+		SPI_cursor_fetch(c->portal, true, batch_rows);
+
+		if (SPI_tuptable == NULL)
+			elog(ERROR, "cannot fetch data");
+
+		/*
+		 * Fetched rows are not copied. The memory context of SPI tuptable
+		 * is moved under tuples context, so rows, their descriptor and
+		 * the array of rows survive SPI_finish, and they are released
+		 * when tuples context is reset.
+		 */
+		MemoryContextSetParent(SPI_tuptable->tuptabcxt, c->tuples_cxt);
+
+		c->tupdesc = SPI_tuptable->tupdesc;
+		c->tuples = SPI_tuptable->vals;
+		processed = SPI_processed;
+
+		SPI_finish();
+	}
+
+	if (exact && processed > 1)
+		ereport(ERROR,
+			    (errcode(ERRCODE_TOO_MANY_ROWS),
+			     errmsg("too many rows"),
+			     errdetail("In exact mode only one row is expected")));
+
+	if (exact && processed == 0)
+		ereport(ERROR,
+			    (errcode(ERRCODE_NO_DATA_FOUND),
+			     errmsg("no data found"),
+			     errdetail("In exact mode only one row is expected")));
+
+	for (i = 0; i < processed; i++)
+		width += c->tuples[i]->t_len;
+
+	if (processed > 0)
+		c->avg_tuple_width = (int) (width / processed) + HEAPTUPLESIZE;
+
+	c->stats.fetch_calls += 1;
+	c->stats.fetched_rows += processed;
+	c->stats.fetched_bytes += width;
+
+	deform_tuples(c, processed);
+
+	c->processed = processed;
+	c->nread = 0;
+
+	if (max_memory > 0)
+	{
+		add_memory_usage_estimate(width + processed * HEAPTUPLESIZE);
+		check_memory_limit();
+	}
+
+	if (statements_hash || log_min_duration >= 0)
+		add_elapsed_time(&elapsed, start_time);
+
+	if (statements_hash)
+		statement_stats_store(c, true, elapsed, processed, 0);
+
+	if (log_min_duration >= 0)
+		log_slow_statement(c, elapsed, true);
+}
+
+static void
+check_fetch(CursorData *c)
+{
+	if (!c->executed)
+		ereport(ERROR,
+			    (errcode(ERRCODE_INVALID_CURSOR_STATE),
+			     errmsg("cursor is not executed")));
+
+	if (!get_portal(c) && !c->drained_tuptable)
+		ereport(ERROR,
+			    (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+			     errmsg("cursor has not portal")));
+
+	/* the columns of cursor created by to_cursor_number are defined after execution */
+	if (!c->coltupdesc)
+	{
+		if (!c->columns)
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_CURSOR_STATE),
+					 errmsg("no column is defined")));
+
+		prepare_result_columns(c);
+		check_result_columns(c, c->portal->tupDesc);
+	}
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.to_refcursor(c int) RETURNS refcursor;
+ *
+ * Pass the portal of executed query to refcursor. The cursor is closed,
+ * and the result can be read only by FETCH statement.
+ */
+Datum
+dbms_sql_to_refcursor(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	text	   *result;
+
+	c = get_cursor(fcinfo, true);
+
+	if (c->parallel)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cursor with parallel flag cannot be passed as refcursor"),
+				 errdetail("All rows of parallel query are read by execute, so there is no portal.")));
+
+	/*
+	 * The query without defined columns is executed by execute to end, and
+	 * its rows are not available. So the portal is opened here, when the
+	 * cursor was not executed.
+	 */
+	if (!c->executed && c->parsed_query)
+		(void) execute(c, true);
+
+	if (!c->executed || !get_portal(c))
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_CURSOR_STATE),
+				 errmsg("cursor is not executed query"),
+				 errhint("The query without defined columns should not be executed before to_refcursor.")));
+
+	if (c->tuples_cxt)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_CURSOR_STATE),
+				 errmsg("cursor is fetched already")));
+
+	result = cstring_to_text(c->cursorname);
+
+	/* the portal is not closed by close of cursor */
+	c->portal = NULL;
+	c->executed = false;
+
+	release_cursor(c);
+
+	PG_RETURN_TEXT_P(result);
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.to_cursor_number(rc refcursor) RETURNS int;
+ *
+ * Returns new cursor that reads the portal of refcursor. The columns
+ * should be defined before fetch.
+ */
+Datum
+dbms_sql_to_cursor_number(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	Portal		portal;
+	char	   *name;
+
+	if (PG_ARGISNULL(0))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("refcursor is NULL")));
+
+	name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+
+	portal = SPI_cursor_find(name);
+	if (!portal)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_CURSOR),
+				 errmsg("cursor \"%s\" does not exist", name)));
+
+	if (!portal->tupDesc)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_CURSOR_STATE),
+				 errmsg("cursor \"%s\" doesn't return rows", name)));
+
+	if (strlen(name) >= NAMEDATALEN)
+		ereport(ERROR,
+				(errcode(ERRCODE_NAME_TOO_LONG),
+				 errmsg("cursor name \"%s\" is too long", name)));
+
+	c = cursors[open_new_cursor()];
+
+	c->holdable = (portal->cursorOptions & CURSOR_OPT_HOLD) != 0;
+	reset_cursor_xact_cxt(c);
+
+	strcpy(c->cursorname, name);
+	c->portal = portal;
+	c->executed = true;
+
+	if (portal->sourceText)
+		c->original_query = MemoryContextStrdup(c->cursor_cxt, portal->sourceText);
+
+	PG_RETURN_INT32(c->cid);
+}
+
+static int
+fetch_rows(CursorData *c, bool exact)
+{
+	int		can_read_rows;
+
+	check_fetch(c);
+
+	if (c->nread == c->processed)
+		fetch_batch(c, exact);
+
+	if (c->processed - c->nread >= c->batch_rows)
+		can_read_rows = c->batch_rows;
+	else
+		can_read_rows = c->processed - c->nread;
+
+	c->start_read = c->nread;
+	c->nread += can_read_rows;
+
+	last_row_count = can_read_rows;
+
+	return can_read_rows;
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.fetch_rows(c int) RETURNS int;
+ */
+Datum
+dbms_sql_fetch_rows(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+
+	c = get_cursor(fcinfo, true);
+
+	PG_RETURN_INT32(fetch_rows(c, false));
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.execute_and_fetch(c int, exact bool DEFAULT false) RETURNS int;
+ */
+Datum
+dbms_sql_execute_and_fetch(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	bool		exact;
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("exact option is NULL")));
+
+	exact = PG_GETARG_BOOL(1);
+
+	execute(c, false);
+
+	PG_RETURN_INT32(fetch_rows(c, exact));
+}
+
+/*
+ * State of fetch_all function
+ */
+typedef struct
+{
+	CursorData *c;
+	TupleDesc	tupdesc;
+	CastCacheEntry **casts;
+	Datum	   *values;
+	bool	   *nulls;
+} FetchAllState;
+
+/*
+ * CREATE FUNCTION dbms_sql.fetch_all(c int) RETURNS SETOF record;
+ * Returns all not fetched rows of cursor. Rows are fetched from portal
+ * by batches, and they are returned one by one. Note, the function scan
+ * stores all returned rows in tuplestore, so the result is not streamed.
+ */
+Datum
+dbms_sql_fetch_all(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *funcctx;
+	FetchAllState *state;
+	CursorData *c;
+	HeapTuple	tuple;
+	int			natts;
+	int			i;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		MemoryContext oldcxt;
+		TupleDesc	tupdesc;
+
+		funcctx = SRF_FIRSTCALL_INIT();
+
+		c = get_cursor(fcinfo, true);
+
+		if (!c->executed)
+		{
+			if (!c->columns)
+				ereport(ERROR,
+						(errcode(ERRCODE_UNDEFINED_COLUMN),
+						 errmsg("no column is defined"),
+						 errhint("Columns should be defined or cursor should be executed before.")));
 
-								for (j = 1; j < max_index1; j++)
-								{
-									Datum		value;
-									bool		isnull;
+			execute(c, false);
+		}
 
-									has_value = array_iterate(iterators[i], &value, &isnull);
-									if (!has_value)
-										break;
-								}
+		check_fetch(c);
 
-								if (!has_value)
-									break;
-							}
+		if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("function returning record called in context "
+							"that cannot accept type record")));
 
-							i += 1;
-						}
-					}
-				}
-			}
+		oldcxt = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
-			while (has_value && (max_rows == -1 || max_rows > 0))
-			{
-				int			rc;
+		state = palloc0(sizeof(FetchAllState));
+		state->c = c;
+		state->tupdesc = BlessTupleDesc(CreateTupleDescCopy(tupdesc));
+		state->casts = palloc0(sizeof(CastCacheEntry *) * tupdesc->natts);
+		state->values = palloc(sizeof(Datum) * tupdesc->natts);
+		state->nulls = palloc(sizeof(bool) * tupdesc->natts);
 
-				i = 0;
-				foreach(lc, c->variables)
-				{
-					VariableData *var = (VariableData *) lfirst(lc);
+		funcctx->user_fctx = state;
 
-					if (var->is_array)
-					{
-						Datum		value;
-						bool		isnull;
+		MemoryContextSwitchTo(oldcxt);
+	}
 
-						has_value = array_iterate(iterators[i], &value, &isnull);
-						if (!has_value)
-							break;
+	funcctx = SRF_PERCALL_SETUP();
+	state = (FetchAllState *) funcctx->user_fctx;
+	c = state->c;
+	natts = state->tupdesc->natts;
 
-						values[i] = value;
-						nulls[i] = isnull ? 'n' : ' ';
-					}
+	check_fetch(c);
 
-					i += 1;
-				}
-				if (!has_value)
-					break;
+	if (c->nread >= c->processed)
+	{
+		fetch_batch(c, false);
 
-				rc = SPI_execute_plan(c->plan, values, nulls, false, 0);
-				if (rc < 0)
-					/* internal error */
-					elog(ERROR, "cannot to execute a query");
+		if (c->processed == 0)
+			SRF_RETURN_DONE(funcctx);
+	}
 
-				result += SPI_processed;
+	if (c->tupdesc->natts != natts)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("returned record type does not match expected record type"),
+				 errdetail("Query returns %d columns, but %d columns are expected.",
+						   c->tupdesc->natts, natts)));
 
-				if (max_rows > 0)
-					max_rows -= 1;
-			}
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(state->tupdesc, i);
+		uint64		idx = (uint64) i * c->processed + c->nread;
 
-			MemoryContextReset(c->result_cxt);
-		}
-		else
+		if (!state->casts[i] || !state->casts[i]->isvalid)
 		{
-			int			rc;
-
-			rc = SPI_execute_plan(c->plan, values, nulls, false, 0);
-			if (rc < 0)
-				/* internal error */
-				elog(ERROR, "cannot to execute a query");
-
-			result = SPI_processed;
+			state->casts[i] = get_cast_cache_entry(att->atttypid,
+												   att->atttypmod,
+												   SPI_gettypeid(c->tupdesc, i + 1),
+												   true);
+			c->stats.cast_misses += 1;
 		}
 
-		SPI_finish();
+		state->nulls[i] = c->colnulls[idx];
+		state->values[i] = cast_value(state->casts[i],
+									  c->colvalues[idx],
+									  state->nulls[i]);
+	}
 
-		MemoryContextSwitchTo(oldcxt);
+	c->nread += 1;
 
-		return result;
-	}
+	tuple = heap_form_tuple(state->tupdesc, state->values, state->nulls);
 
-	return 0L;
+	SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
 }
 
 /*
- * CREATE FUNCTION dbms_sql.execute(c int) RETURNS bigint;
+ * CREATE FUNCTION dbms_sql.last_row_count() RETURNS int;
  */
 Datum
-dbms_sql_execute(PG_FUNCTION_ARGS)
+dbms_sql_last_row_count(PG_FUNCTION_ARGS)
 {
-	CursorData *c;
-
-	c = get_cursor(fcinfo, true);
+	(void) fcinfo;
 
-	PG_RETURN_INT64(execute(c));
+	PG_RETURN_INT32(last_row_count);
 }
 
-static int
-fetch_rows(CursorData *c, bool exact)
+/*
+ * CREATE PROCEDURE dbms_sql.set_prefetch_rows(c int, rows int);
+ */
+Datum
+dbms_sql_set_prefetch_rows(PG_FUNCTION_ARGS)
 {
-	int		can_read_rows;
+	CursorData *c;
+	int			rows;
 
-	if (!c->executed)
-		ereport(ERROR,
-			    (errcode(ERRCODE_INVALID_CURSOR_STATE),
-			     errmsg("cursor is not executed")));
+	c = get_cursor(fcinfo, true);
 
-	if (!c->portal)
+	if (PG_ARGISNULL(1))
 		ereport(ERROR,
-			    (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
-			     errmsg("cursor has not portal")));
-
-	if (c->nread == c->processed)
-	{
-		MemoryContext	oldcxt;
-		uint64		i;
-		int			batch_rows;
-
-		if (!exact)
-		{
-			if (c->array_columns)
-				batch_rows = (1000 / c->batch_rows) * c->batch_rows;
-			else
-				batch_rows = 1000;
-		}
-		else
-			batch_rows = 2;
-
-		/* create or reset context for tuples */
-		if (!c->tuples_cxt)
-			c->tuples_cxt = AllocSetContextCreate(c->cursor_xact_cxt,
-												  "dbms_sql tuples context",
-												  ALLOCSET_DEFAULT_SIZES);
-		else
-			MemoryContextReset(c->tuples_cxt);
-
-		if (SPI_connect() != SPI_OK_CONNECT)
-			elog(ERROR, "SPI_connact failed");
-
-		/* try to fetch data from cursor */
-		SPI_cursor_fetch(c->portal, true, batch_rows);
-
-		if (SPI_tuptable == NULL)
-			elog(ERROR, "cannot fetch data");
-
-		if (exact && SPI_processed > 1)
-			ereport(ERROR,
-				    (errcode(ERRCODE_TOO_MANY_ROWS),
-				     errmsg("too many rows"),
-				     errdetail("In exact mode only one row is expected")));
-
-		if (exact && SPI_processed == 0)
-			ereport(ERROR,
-				    (errcode(ERRCODE_NO_DATA_FOUND),
-				     errmsg("no data found"),
-				     errdetail("In exact mode only one row is expected")));
-
-		oldcxt = MemoryContextSwitchTo(c->tuples_cxt);
-
-		c->tupdesc = CreateTupleDescCopy(SPI_tuptable->tupdesc);
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("number of prefetched rows is NULL")));
 
-		for (i = 0; i < SPI_processed; i++)
-			c->tuples[i] = heap_copytuple(SPI_tuptable->vals[i]);
+	rows = PG_GETARG_INT32(1);
+	if (rows < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of prefetched rows is negative")));
 
-		MemoryContextSwitchTo(oldcxt);
+	/* zero means default, specified by dbms_sql.prefetch_rows */
+	c->prefetch_rows = rows;
 
-		c->processed = SPI_processed;
-		c->nread = 0;
+	return (Datum) 0;
+}
 
-		SPI_finish();
-	}
+/*
+ * CREATE PROCEDURE dbms_sql.set_parallel(c int, enabled bool);
+ */
+Datum
+dbms_sql_set_parallel(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
 
-	if (c->processed - c->nread >= c->batch_rows)
-		can_read_rows = c->batch_rows;
-	else
-		can_read_rows = c->processed - c->nread;
+	c = get_cursor(fcinfo, true);
 
-	c->start_read = c->nread;
-	c->nread += can_read_rows;
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("enabled option is NULL")));
 
-	last_row_count = can_read_rows;
+	/* it is used by next execution */
+	c->parallel = PG_GETARG_BOOL(1);
 
-	return can_read_rows;
+	return (Datum) 0;
 }
 
 /*
- * CREATE FUNCTION dbms_sql.fetch_rows(c int) RETURNS int;
+ * CREATE PROCEDURE dbms_sql.set_holdable(c int, enabled bool);
  */
 Datum
-dbms_sql_fetch_rows(PG_FUNCTION_ARGS)
+dbms_sql_set_holdable(PG_FUNCTION_ARGS)
 {
 	CursorData *c;
 
 	c = get_cursor(fcinfo, true);
 
-	PG_RETURN_INT32(fetch_rows(c, false));
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("enabled option is NULL")));
+
+	/* it is used by next execution */
+	c->holdable = PG_GETARG_BOOL(1);
+
+	return (Datum) 0;
 }
 
 /*
- * CREATE FUNCTION dbms_sql.execute_and_fetch(c int, exact bool DEFAULT false) RETURNS int;
+ * CREATE PROCEDURE dbms_sql.set_direct_load(c int, enabled bool);
  */
 Datum
-dbms_sql_execute_and_fetch(PG_FUNCTION_ARGS)
+dbms_sql_set_direct_load(PG_FUNCTION_ARGS)
 {
 	CursorData *c;
-	bool		exact;
 
 	c = get_cursor(fcinfo, true);
 
 	if (PG_ARGISNULL(1))
 		ereport(ERROR,
 			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("exact option is NULL")));
+			     errmsg("enabled option is NULL")));
 
-	exact = PG_GETARG_BOOL(1);
-
-	execute(c);
+	/* it is used by next execution */
+	c->direct_load = PG_GETARG_BOOL(1);
 
-	PG_RETURN_INT32(fetch_rows(c, exact));
+	return (Datum) 0;
 }
 
 /*
- * CREATE FUNCTION dbms_sql.last_row_count() RETURNS int;
+ * Any change of types, casts or functions can change casts. The entries
+ * are not removed, because they can be referenced by cursors. Only entries
+ * related to changed type or function are invalidated. Any change of casts
+ * (or the reset of cache, when hashvalue is zero) invalidates all entries.
  */
-Datum
-dbms_sql_last_row_count(PG_FUNCTION_ARGS)
+static void
+cast_cache_invalidate(Datum arg, int cacheid, uint32 hashvalue)
 {
-	(void) fcinfo;
+	HASH_SEQ_STATUS status;
+	CastCacheEntry *entry;
 
-	PG_RETURN_INT32(last_row_count);
+	if (!cast_cache)
+		return;
+
+	hash_seq_init(&status, cast_cache);
+
+	while ((entry = (CastCacheEntry *) hash_seq_search(&status)) != NULL)
+	{
+		if (hashvalue != 0 && cacheid != CASTSOURCETARGET)
+		{
+			uint32	   *hashes;
+			int			nhashes;
+			bool		depends = false;
+			int			i;
+
+			if (cacheid == TYPEOID)
+			{
+				hashes = entry->type_hashes;
+				nhashes = lengthof(entry->type_hashes);
+			}
+			else
+			{
+				hashes = entry->func_hashes;
+				nhashes = lengthof(entry->func_hashes);
+			}
+
+			for (i = 0; i < nhashes; i++)
+			{
+				if (hashes[i] == hashvalue)
+				{
+					depends = true;
+					break;
+				}
+			}
+
+			if (!depends)
+				continue;
+		}
+
+		entry->isvalid = false;
+	}
 }
 
 /*
- * Initialize cast case entry.
+ * Initialize cast cache entry.
  */
 static void
-init_cast_cache_entry(CastCacheData *ccast,
+init_cast_cache_entry(CastCacheEntry *centry,
 					  Oid targettypid,
 					  int32 targettypmod,
 					  Oid sourcetypid)
@@ -1467,68 +5811,329 @@ init_cast_cache_entry(CastCacheData *ccast,
 	Oid		funcoid;
 	Oid		basetypid;
 
+	/*
+	 * The functions can allocate memory in fn_mcxt, so this memory is
+	 * released when the entry is initialized again.
+	 */
+	if (centry->fn_cxt)
+		MemoryContextReset(centry->fn_cxt);
+	else
+		centry->fn_cxt = AllocSetContextCreate(cast_cache_cxt,
+											   "dbms_sql cast",
+											   ALLOCSET_SMALL_SIZES);
+
+	memset(centry->func_hashes, 0, sizeof(centry->func_hashes));
+
 	basetypid = getBaseType(targettypid);
 
+	centry->type_hashes[0] = GetSysCacheHashValue1(TYPEOID, ObjectIdGetDatum(sourcetypid));
+	centry->type_hashes[1] = GetSysCacheHashValue1(TYPEOID, ObjectIdGetDatum(targettypid));
+	centry->type_hashes[2] = GetSysCacheHashValue1(TYPEOID, ObjectIdGetDatum(basetypid));
+
 	if (targettypid != basetypid)
-		ccast->targettypid = targettypid;
+		centry->targettypid = targettypid;
 	else
-		ccast->targettypid = InvalidOid;
+		centry->targettypid = InvalidOid;
 
-	ccast->targettypmod = targettypmod;
+	centry->targettypmod = targettypmod;
+	centry->basetypid = basetypid;
+	centry->array_basetypid = get_array_type(basetypid);
+
+	get_typlenbyvalalign(basetypid,
+						 &centry->typlen,
+						 &centry->typbyval,
+						 &centry->typalign);
 
 	if (sourcetypid == targettypid)
-		ccast->without_cast = targettypmod == -1;
+		centry->without_cast = targettypmod == -1;
 	else
-		ccast->without_cast = false;
+		centry->without_cast = false;
 
-	if (!ccast->without_cast)
+	if (!centry->without_cast)
 	{
-		ccast->path = find_coercion_pathway(basetypid,
-											sourcetypid,
-											COERCION_ASSIGNMENT,
-											&funcoid);
+		centry->path = find_coercion_pathway(basetypid,
+											 sourcetypid,
+											 COERCION_ASSIGNMENT,
+											 &funcoid);
 
-		if (ccast->path == COERCION_PATH_NONE)
+		if (centry->path == COERCION_PATH_NONE)
 			ereport(ERROR,
 			    (errcode(ERRCODE_CANNOT_COERCE),
 			     errmsg("cannot to find cast from source type \"%s\" to target type \"%s\"",
 						 format_type_be(sourcetypid),
 						 format_type_be(basetypid))));
 
-		if (ccast->path == COERCION_PATH_FUNC)
+		if (centry->path == COERCION_PATH_FUNC)
 		{
-			fmgr_info(funcoid, &ccast->finfo);
+			fmgr_info_cxt(funcoid, &centry->finfo, centry->fn_cxt);
+			centry->func_hashes[0] = GetSysCacheHashValue1(PROCOID, ObjectIdGetDatum(funcoid));
 		}
-		else if (ccast->path == COERCION_PATH_COERCEVIAIO)
+		else if (centry->path == COERCION_PATH_COERCEVIAIO)
 		{
 			bool	typisvarlena;
 
 			getTypeOutputInfo(sourcetypid, &funcoid, &typisvarlena);
-			fmgr_info(funcoid, &ccast->finfo_out);
+			fmgr_info_cxt(funcoid, &centry->finfo_out, centry->fn_cxt);
+			centry->func_hashes[1] = GetSysCacheHashValue1(PROCOID, ObjectIdGetDatum(funcoid));
 
-			getTypeInputInfo(targettypid, &funcoid, &ccast->typIOParam);
-			fmgr_info(funcoid, &ccast->finfo_in);
+			getTypeInputInfo(targettypid, &funcoid, &centry->typIOParam);
+			fmgr_info_cxt(funcoid, &centry->finfo_in, centry->fn_cxt);
+			centry->func_hashes[2] = GetSysCacheHashValue1(PROCOID, ObjectIdGetDatum(funcoid));
 		}
 
 		if (targettypmod != -1)
 		{
-			ccast->path_typmod = find_typmod_coercion_function(targettypid,
-															   &funcoid);
-			if (ccast->path_typmod == COERCION_PATH_FUNC)
-				fmgr_info(funcoid, &ccast->finfo_typmod);
+			centry->path_typmod = find_typmod_coercion_function(targettypid,
+																&funcoid);
+			if (centry->path_typmod == COERCION_PATH_FUNC)
+			{
+				fmgr_info_cxt(funcoid, &centry->finfo_typmod, centry->fn_cxt);
+				centry->func_hashes[3] = GetSysCacheHashValue1(PROCOID, ObjectIdGetDatum(funcoid));
+			}
+		}
+
+		centry->kernel = get_cast_kernel(centry, sourcetypid);
+	}
+	else
+		centry->kernel = CAST_KERNEL_GENERIC;
+
+	centry->isvalid = true;
+}
+
+/*
+ * Returns specialized cast for common pairs of types. The typmod
+ * and domain of target are applied after this cast like after generic
+ * cast.
+ */
+static CastKernel
+get_cast_kernel(CastCacheEntry *centry, Oid sourcetypid)
+{
+	Oid			targettypid = centry->basetypid;
+
+	if (centry->path == COERCION_PATH_FUNC)
+	{
+		switch (sourcetypid)
+		{
+			case INT2OID:
+				if (targettypid == INT4OID)
+					return CAST_KERNEL_INT2_INT4;
+				else if (targettypid == INT8OID)
+					return CAST_KERNEL_INT2_INT8;
+				else if (targettypid == FLOAT8OID)
+					return CAST_KERNEL_INT2_FLOAT8;
+				break;
+
+			case INT4OID:
+				if (targettypid == INT2OID)
+					return CAST_KERNEL_INT4_INT2;
+				else if (targettypid == INT8OID)
+					return CAST_KERNEL_INT4_INT8;
+				else if (targettypid == FLOAT8OID)
+					return CAST_KERNEL_INT4_FLOAT8;
+				break;
+
+			case INT8OID:
+				if (targettypid == INT2OID)
+					return CAST_KERNEL_INT8_INT2;
+				else if (targettypid == INT4OID)
+					return CAST_KERNEL_INT8_INT4;
+				else if (targettypid == FLOAT8OID)
+					return CAST_KERNEL_INT8_FLOAT8;
+				break;
+
+			case FLOAT4OID:
+				if (targettypid == FLOAT8OID)
+					return CAST_KERNEL_FLOAT4_FLOAT8;
+				break;
 		}
+
+#if PG_VERSION_NUM >= 140000
+
+		if (targettypid == NUMERICOID &&
+			(sourcetypid == INT2OID || sourcetypid == INT4OID || sourcetypid == INT8OID))
+			return CAST_KERNEL_INT_NUMERIC;
+
+#endif
+
+	}
+	else if (centry->path == COERCION_PATH_COERCEVIAIO)
+	{
+		/*
+		 * The input functions of string types with default typmod only
+		 * copy the string. The output of text types is just the content.
+		 */
+		if (targettypid == TEXTOID ||
+			((targettypid == VARCHAROID || targettypid == BPCHAROID) &&
+			 centry->targettypmod == -1))
+			return CAST_KERNEL_OUT_TEXT;
+
+		if (sourcetypid == TEXTOID || sourcetypid == VARCHAROID ||
+			sourcetypid == BPCHAROID)
+			return CAST_KERNEL_TEXT_IN;
+	}
+
+	return CAST_KERNEL_GENERIC;
+}
+
+/*
+ * Returns valid cast cache entry
+ */
+static CastCacheEntry *
+get_cast_cache_entry(Oid targettypid,
+					 int32 targettypmod,
+					 Oid sourcetypid,
+					 bool isexplicit)
+{
+	CastCacheEntry *centry;
+	CastCacheKey key;
+	bool		found;
+
+	if (!cast_cache)
+	{
+		HASHCTL		ctl;
+
+		cast_cache_cxt = AllocSetContextCreate(persist_cxt,
+											   "dbms_sql cast cache",
+											   ALLOCSET_DEFAULT_SIZES);
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(CastCacheKey);
+		ctl.entrysize = sizeof(CastCacheEntry);
+		ctl.hcxt = cast_cache_cxt;
+
+		cast_cache = hash_create("dbms_sql cast cache",
+								 64,
+								 &ctl,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.sourcetypid = sourcetypid;
+	key.targettypid = targettypid;
+	key.targettypmod = targettypmod;
+	key.isexplicit = isexplicit;
+
+	centry = (CastCacheEntry *) hash_search(cast_cache, &key, HASH_ENTER, &found);
+	if (!found)
+	{
+		centry->isvalid = false;
+		centry->fn_cxt = NULL;
+	}
+
+	if (!centry->isvalid)
+		init_cast_cache_entry(centry, targettypid, targettypmod, sourcetypid);
+
+	return centry;
+}
+
+/*
+ * Specialized casts. The errors are same like errors of cast functions.
+ */
+static Datum
+cast_value_kernel(CastCacheEntry *ccast, Datum value)
+{
+	switch (ccast->kernel)
+	{
+		case CAST_KERNEL_INT2_INT4:
+			return Int32GetDatum((int32) DatumGetInt16(value));
+
+		case CAST_KERNEL_INT2_INT8:
+			return Int64GetDatum((int64) DatumGetInt16(value));
+
+		case CAST_KERNEL_INT4_INT8:
+			return Int64GetDatum((int64) DatumGetInt32(value));
+
+		case CAST_KERNEL_INT4_INT2:
+			{
+				int32		v = DatumGetInt32(value);
+
+				if (unlikely(v < PG_INT16_MIN || v > PG_INT16_MAX))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("smallint out of range")));
+
+				return Int16GetDatum((int16) v);
+			}
+
+		case CAST_KERNEL_INT8_INT2:
+			{
+				int64		v = DatumGetInt64(value);
+
+				if (unlikely(v < PG_INT16_MIN || v > PG_INT16_MAX))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("smallint out of range")));
+
+				return Int16GetDatum((int16) v);
+			}
+
+		case CAST_KERNEL_INT8_INT4:
+			{
+				int64		v = DatumGetInt64(value);
+
+				if (unlikely(v < PG_INT32_MIN || v > PG_INT32_MAX))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("integer out of range")));
+
+				return Int32GetDatum((int32) v);
+			}
+
+		case CAST_KERNEL_INT2_FLOAT8:
+			return Float8GetDatum((float8) DatumGetInt16(value));
+
+		case CAST_KERNEL_INT4_FLOAT8:
+			return Float8GetDatum((float8) DatumGetInt32(value));
+
+		case CAST_KERNEL_INT8_FLOAT8:
+			return Float8GetDatum((float8) DatumGetInt64(value));
+
+		case CAST_KERNEL_FLOAT4_FLOAT8:
+			return Float8GetDatum((float8) DatumGetFloat4(value));
+
+#if PG_VERSION_NUM >= 140000
+
+		case CAST_KERNEL_INT_NUMERIC:
+			{
+				int64		v;
+
+				if (ccast->key.sourcetypid == INT2OID)
+					v = DatumGetInt16(value);
+				else if (ccast->key.sourcetypid == INT4OID)
+					v = DatumGetInt32(value);
+				else
+					v = DatumGetInt64(value);
+
+				return NumericGetDatum(int64_to_numeric(v));
+			}
+
+#endif
+
+		case CAST_KERNEL_OUT_TEXT:
+			return CStringGetTextDatum(OutputFunctionCall(&ccast->finfo_out, value));
+
+		case CAST_KERNEL_TEXT_IN:
+			return InputFunctionCall(&ccast->finfo_in,
+									 TextDatumGetCString(value),
+									 ccast->typIOParam,
+									 ccast->targettypmod);
+
+		default:
+			elog(ERROR, "unexpected cast kernel %d", ccast->kernel);
 	}
 
-	ccast->isvalid = true;
+	return value;
 }
 
 /*
  * Apply cast rules to a value
  */
 static Datum
-cast_value(CastCacheData *ccast, Datum value, bool isnull)
+cast_value(CastCacheEntry *ccast, Datum value, bool isnull)
 {
-	if (!isnull && !ccast->without_cast)
+	if (!isnull && !ccast->without_cast && ccast->kernel != CAST_KERNEL_GENERIC)
+		value = cast_value_kernel(ccast, value);
+	else if (!isnull && !ccast->without_cast)
 	{
 		if (ccast->path == COERCION_PATH_FUNC)
 			value = FunctionCall1(&ccast->finfo, value);
@@ -1548,32 +6153,197 @@ cast_value(CastCacheData *ccast, Datum value, bool isnull)
 			ereport(ERROR,
 				    (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
 				     errmsg("unsupported cast path yet %d", ccast->path)));
-
-		if (ccast->targettypmod != -1 && ccast->path_typmod == COERCION_PATH_FUNC)
-			value = FunctionCall3(&ccast->finfo_typmod,
-								  value,
-								  Int32GetDatum(ccast->targettypmod),
-								  BoolGetDatum(true));
 	}
 
+	if (!isnull && !ccast->without_cast &&
+		ccast->targettypmod != -1 && ccast->path_typmod == COERCION_PATH_FUNC)
+		value = FunctionCall3(&ccast->finfo_typmod,
+							  value,
+							  Int32GetDatum(ccast->targettypmod),
+							  BoolGetDatum(ccast->key.isexplicit));
+
 	if (ccast->targettypid != InvalidOid)
 		domain_check(value, isnull, ccast->targettypid, NULL, NULL);
 
 	return value;
 }
 
+/*
+ * Build one dimensional array from column vector. The values of by value
+ * fixed length types without NULLs are copyied directly to data area of
+ * array.
+ */
+static Datum
+make_column_array(CastCacheEntry *ccast,
+				  Oid elemtypid,
+				  Datum *colvalues,
+				  bool *colnulls,
+				  int nitems)
+{
+	Datum	   *elems;
+	bool	   *nulls;
+	bool		has_nulls = false;
+	int			dims[1];
+	int			lbs[1];
+	int			i;
+
+	if (nitems == 0)
+		return PointerGetDatum(construct_empty_array(elemtypid));
+
+	for (i = 0; i < nitems; i++)
+	{
+		if (colnulls[i])
+		{
+			has_nulls = true;
+			break;
+		}
+	}
+
+	if (!has_nulls &&
+		ccast->without_cast &&
+		ccast->targettypid == InvalidOid &&
+		ccast->typbyval &&
+		ccast->typlen > 0)
+	{
+		ArrayType  *result;
+		int			itemsize;
+		Size		nbytes;
+		char	   *ptr;
+
+		itemsize = att_align_nominal(ccast->typlen, ccast->typalign);
+		nbytes = ARR_OVERHEAD_NONULLS(1) + (Size) itemsize * nitems;
+
+		result = (ArrayType *) palloc0(nbytes);
+		SET_VARSIZE(result, nbytes);
+		result->ndim = 1;
+		result->dataoffset = 0;
+		result->elemtype = elemtypid;
+		ARR_DIMS(result)[0] = nitems;
+		ARR_LBOUND(result)[0] = 1;
+
+		ptr = ARR_DATA_PTR(result);
+
+		/* the Datum has same format like stored value */
+		if (itemsize == sizeof(Datum))
+			memcpy(ptr, colvalues, sizeof(Datum) * nitems);
+		else
+		{
+			for (i = 0; i < nitems; i++)
+			{
+				store_att_byval(ptr, colvalues[i], ccast->typlen);
+				ptr += itemsize;
+			}
+		}
+
+		return PointerGetDatum(result);
+	}
+
+	elems = palloc(sizeof(Datum) * nitems);
+	nulls = has_nulls ? palloc(sizeof(bool) * nitems) : NULL;
+
+	for (i = 0; i < nitems; i++)
+	{
+		elems[i] = cast_value(ccast, colvalues[i], colnulls[i]);
+		if (nulls)
+			nulls[i] = colnulls[i];
+	}
+
+	dims[0] = nitems;
+	lbs[0] = 1;
+
+	return PointerGetDatum(construct_md_array(elems, nulls, 1, dims, lbs,
+											  elemtypid,
+											  ccast->typlen,
+											  ccast->typbyval,
+											  ccast->typalign));
+}
+
+/*
+ * Write column vector to target array from index next_index. When the target
+ * is read/write expanded array, then it is modified in place, so appending
+ * of batches to an collection has linear cost. Else the target is expanded
+ * (copied) before. The result is read/write expanded array. The values are
+ * casted before the target is modified, so an error of cast cannot to leave
+ * partially written batch in the target.
+ */
+static Datum
+accumulate_column_array(CastCacheEntry *ccast,
+						Oid elemtypid,
+						Datum target,
+						bool target_isnull,
+						int next_index,
+						Datum *colvalues,
+						bool *colnulls,
+						int nitems,
+						bool *in_place)
+{
+	ExpandedArrayHeader *eah;
+	Datum		result;
+	Datum	   *values;
+	int			i;
+
+	*in_place = false;
+
+	values = palloc(sizeof(Datum) * nitems);
+
+	for (i = 0; i < nitems; i++)
+		values[i] = cast_value(ccast, colvalues[i], colnulls[i]);
+
+	if (target_isnull)
+		eah = construct_empty_expanded_array(elemtypid, CurrentMemoryContext, NULL);
+	else if (VARATT_IS_EXTERNAL_EXPANDED_RW(DatumGetPointer(target)))
+	{
+		eah = (ExpandedArrayHeader *) DatumGetEOHP(target);
+		*in_place = true;
+	}
+	else
+		eah = (ExpandedArrayHeader *) DatumGetEOHP(expand_array(target,
+																CurrentMemoryContext,
+																NULL));
+
+	if (eah->ndims > 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+				 errmsg("target array of accumulated column should be one dimensional")));
+
+	result = EOHPGetRWDatum(&eah->hdr);
+
+	for (i = 0; i < nitems; i++)
+	{
+		int			idx = next_index + i;
+
+		/* the array is modified in place, so result is same datum */
+		result = array_set_element(result, 1, &idx,
+								   values[i],
+								   colnulls[i],
+								   -1,
+								   ccast->typlen,
+								   ccast->typbyval,
+								   ccast->typalign);
+	}
+
+	pfree(values);
+
+	return result;
+}
+
 /*
  * CALL statement is relatily slow in PLpgSQL - due repated parsing, planning.
  * So I wrote two variant of this routine. When spi_transfer is true, then
  * the value is copyied to SPI outer memory context.
  */
 static Datum
-column_value(CursorData *c, int pos, Oid targetTypeId, bool *isnull, bool spi_transfer)
+column_value(CursorData *c, int pos, Oid targetTypeId,
+			 Datum target, bool target_isnull,
+			 bool *isnull, bool spi_transfer)
 {
 	Datum		value;
+	bool		in_place = false;
 	int32		columnTypeMode;
 	Oid			columnTypeId;
 	CastCacheData *ccast;
+	Datum	   *colvalues;
+	bool	   *colnulls;
 
 	if (!c->executed)
 		ereport(ERROR,
@@ -1590,74 +6360,98 @@ column_value(CursorData *c, int pos, Oid targetTypeId, bool *isnull, bool spi_tr
 			    (errcode(ERRCODE_UNDEFINED_COLUMN),
 			     errmsg("no column is defined")));
 
-	if (pos < 1 && pos > c->coltupdesc->natts)
+	if (pos < 1 || pos > c->coltupdesc->natts)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("column position is of of range [1, %d]",
 						c->coltupdesc->natts)));
 
+	if (pos > c->tupdesc->natts)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("column position is of of range [1, %d]",
+						c->tupdesc->natts)));
+
+	/* column vector of fetched rows */
+	colvalues = c->colvalues + (pos - 1) * c->processed;
+	colnulls = c->colnulls + (pos - 1) * c->processed;
+
 	columnTypeId = (TupleDescAttr(c->coltupdesc, pos - 1))->atttypid;
 	columnTypeMode = (TupleDescAttr(c->coltupdesc, pos - 1))->atttypmod;
 
 	Assert(c->casts);
 	ccast = &c->casts[pos - 1];
 
-	if (!ccast->isvalid)
+	if (!ccast->isvalid || !ccast->cast->isvalid)
 	{
-		Oid		basetype = getBaseType(targetTypeId);
-	
-		init_cast_cache_entry(ccast,
-							  columnTypeId,
-							  columnTypeMode,
-							  SPI_gettypeid(c->tupdesc, pos));
+		CastCacheEntry *centry;
+
+		centry = get_cast_cache_entry(columnTypeId,
+									  columnTypeMode,
+									  SPI_gettypeid(c->tupdesc, pos),
+									  true);
 
+		ccast->cast = centry;
 		ccast->is_array = bms_is_member(pos, c->array_columns);
 
+		c->stats.cast_misses += 1;
+
 		if (ccast->is_array)
 		{
+			/* the target can be a domain over array */
+			Oid		basetype = targetTypeId == centry->array_basetypid ?
+							targetTypeId : getBaseType(targetTypeId);
+
 			ccast->array_targettypid = basetype != targetTypeId ? targetTypeId : InvalidOid;
 
-			if (get_array_type(getBaseType(columnTypeId)) != basetype)
+			if (centry->array_basetypid != basetype)
 				ereport(ERROR,
 					    (errcode(ERRCODE_DATATYPE_MISMATCH),
 					     errmsg("unexpected target type \"%s\" (expected type \"%s\")",
 								format_type_be(basetype),
-								format_type_be(get_array_type(getBaseType(columnTypeId))))));
+								format_type_be(centry->array_basetypid))));
+
+			ccast->typlen = -1;
+			ccast->typbyval = false;
 		}
 		else
+		{
 			ccast->array_targettypid = InvalidOid;
+			ccast->typlen = centry->typlen;
+			ccast->typbyval = centry->typbyval;
+		}
 
-		get_typlenbyval(basetype, &ccast->typlen, &ccast->typbyval);
+		ccast->isvalid = true;
 	}
 
 	if (ccast->is_array)
 	{
-		ArrayBuildState *abs;
-		int		idx;
-		int		i;
+		int			nitems;
 
-		abs = initArrayResult(columnTypeId, CurrentMemoryContext, false);
+		nitems = c->processed - c->start_read;
+		if (nitems > c->batch_rows)
+			nitems = c->batch_rows;
 
-		idx = c->start_read;
-
-		for (i = 0; i < c->batch_rows; i++)
+		if (c->columns_array[pos - 1]->accumulate)
 		{
-			if (idx < c->processed)
-			{
-				value = SPI_getbinval(c->tuples[idx], c->tupdesc, pos, isnull);
-				value = cast_value(ccast, value, *isnull);
-
-				abs = accumArrayResult(abs,
-									   value,
-									   *isnull,
-									   columnTypeId,
-									   CurrentMemoryContext);
-
-				idx += 1;
-			}
+			ColumnData *col = c->columns_array[pos - 1];
+
+			value = accumulate_column_array(ccast->cast, columnTypeId,
+											target, target_isnull,
+											col->next_index,
+											colvalues + c->start_read,
+											colnulls + c->start_read,
+											nitems,
+											&in_place);
+			col->next_index += nitems;
 		}
+		else
+			value = make_column_array(ccast->cast, columnTypeId,
+									  colvalues + c->start_read,
+									  colnulls + c->start_read,
+									  nitems);
 
-		value = makeArrayResult(abs, CurrentMemoryContext);
+		*isnull = false;
 
 		if (ccast->array_targettypid != InvalidOid)
 			domain_check(value, isnull, ccast->array_targettypid, NULL, NULL);
@@ -1672,12 +6466,20 @@ column_value(CursorData *c, int pos, Oid targetTypeId, bool *isnull, bool spi_tr
 								format_type_be(targetTypeId),
 								format_type_be(columnTypeId))));
 
-		value = SPI_getbinval(c->tuples[c->start_read], c->tupdesc, pos, isnull);
+		if (c->start_read >= c->processed)
+			ereport(ERROR,
+					(errcode(ERRCODE_NO_DATA_FOUND),
+					 errmsg("no data found")));
 
-		value = cast_value(ccast, value, *isnull);
+		*isnull = colnulls[c->start_read];
+		value = cast_value(ccast->cast, colvalues[c->start_read], *isnull);
 	}
 
-	if (spi_transfer)
+	/*
+	 * values passed by value need not to be copied, and the target modified
+	 * in place is owned by caller already.
+	 */
+	if (spi_transfer && !ccast->typbyval && !*isnull && !in_place)
 		value = SPI_datumTransfer(value, ccast->typbyval, ccast->typlen);
 
 	return value;
@@ -1734,7 +6536,9 @@ dbms_sql_column_value(PG_FUNCTION_ARGS)
 		/* internal error, should not to be */
 		elog(ERROR, "unexpected function result type");
 
-	value = column_value(c, pos, targetTypeId, &isnull, false);
+	value = column_value(c, pos, targetTypeId,
+						 PG_GETARG_DATUM(2), PG_ARGISNULL(2),
+						 &isnull, false);
 
 	resulttuple = heap_form_tuple(resulttupdesc, &value, &isnull);
 	result = PointerGetDatum(SPI_returntuple(resulttuple, CreateTupleDescCopy(resulttupdesc)));
@@ -1753,38 +6557,341 @@ dbms_sql_column_value(PG_FUNCTION_ARGS)
  * This is reason why this routine is in function form too.
  */
 Datum
-dbms_sql_column_value_f(PG_FUNCTION_ARGS)
+dbms_sql_column_value_f(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	Datum		value;
+	int			pos;
+	bool		isnull;
+	Oid			targetTypeId;
+	MemoryContext	oldcxt;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connact failed");
+
+	c = get_cursor(fcinfo, true);
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("column position (number) is NULL")));
+
+	pos = PG_GETARG_INT32(1);
+
+	oldcxt = MemoryContextSwitchTo(c->result_cxt);
+
+	targetTypeId = get_fn_expr_argtype(fcinfo->flinfo, 2);
+
+	value = column_value(c, pos, targetTypeId,
+						 PG_GETARG_DATUM(2), PG_ARGISNULL(2),
+						 &isnull, true);
+
+	SPI_finish();
+
+	MemoryContextSwitchTo(oldcxt);
+
+	PG_RETURN_DATUM(value);
+}
+
+/*
+ * Planner support function of column_value_f. It allows to PLpgSQL to pass
+ * the target variable as read/write expanded array in assignment like
+ * a := column_value_f(c, pos, a), so accumulated batches are appended
+ * in place. Before PostgreSQL 18 this request is not supported, and the
+ * function does nothing.
+ */
+Datum
+dbms_sql_column_value_f_support(PG_FUNCTION_ARGS)
+{
+
+#if PG_VERSION_NUM >= 180000
+
+	Node	   *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+	if (IsA(rawreq, SupportRequestModifyInPlace))
+	{
+		SupportRequestModifyInPlace *req = (SupportRequestModifyInPlace *) rawreq;
+		Param	   *arg = (Param *) lthird(req->args);
+
+		if (arg && IsA(arg, Param) &&
+			arg->paramkind == PARAM_EXTERN &&
+			arg->paramid == req->paramid)
+			PG_RETURN_POINTER(arg);
+	}
+
+#endif
+
+	PG_RETURN_POINTER(NULL);
+}
+
+/*
+ * Returns value of RETURNING INTO variable. When the target type is an
+ * array, then values of all returned rows are returned. Else the value
+ * of last returned row is returned.
+ */
+static Datum
+variable_value(CursorData *c, char *refname, Oid targetTypeId, bool *isnull)
+{
+	Datum		value;
+	Oid			basetype;
+	Oid			elemtypid;
+	Oid			sourcetypid;
+	CastCacheEntry *centry;
+	ListCell   *lc;
+	int			idx = 0;
+
+	foreach(lc, c->returning_vars)
+	{
+		if (strcmp((char *) lfirst(lc), refname) == 0)
+			break;
+
+		idx += 1;
+	}
+
+	if (!lc)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_PARAMETER),
+				 errmsg("variable \"%s\" is not a RETURNING INTO variable", refname)));
+
+	basetype = getBaseType(targetTypeId);
+	elemtypid = get_element_type(basetype);
+
+	/* nothing was returned */
+	if (!c->returning_tupdesc)
+	{
+		if (OidIsValid(elemtypid))
+		{
+			*isnull = false;
+			value = PointerGetDatum(construct_empty_array(elemtypid));
+
+			if (basetype != targetTypeId)
+				domain_check(value, *isnull, targetTypeId, NULL, NULL);
+		}
+		else
+		{
+			*isnull = true;
+			value = (Datum) 0;
+		}
+	}
+	else
+	{
+		sourcetypid = TupleDescAttr(c->returning_tupdesc, idx)->atttypid;
+
+		/* the array target is filled by values of all rows */
+		if (OidIsValid(elemtypid) && !OidIsValid(get_element_type(sourcetypid)))
+		{
+			centry = get_cast_cache_entry(elemtypid, -1, sourcetypid, true);
+
+			value = make_column_array(centry, elemtypid,
+									  c->returning_values[idx],
+									  c->returning_nulls[idx],
+									  c->returning_rows);
+			*isnull = false;
+
+			if (basetype != targetTypeId)
+				domain_check(value, *isnull, targetTypeId, NULL, NULL);
+		}
+		else
+		{
+			if (c->returning_rows == 0)
+			{
+				*isnull = true;
+				return (Datum) 0;
+			}
+
+			centry = get_cast_cache_entry(targetTypeId, -1, sourcetypid, true);
+
+			*isnull = c->returning_nulls[idx][c->returning_rows - 1];
+			value = cast_value(centry,
+							   c->returning_values[idx][c->returning_rows - 1],
+							   *isnull);
+		}
+	}
+
+	return value;
+}
+
+static char *
+get_variable_name(FunctionCallInfo fcinfo)
+{
+	char	   *varname;
+
+	if (PG_ARGISNULL(1))
+		ereport(ERROR,
+			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+			     errmsg("name of bind variable is NULL")));
+
+	varname = text_to_cstring(PG_GETARG_TEXT_P(1));
+	if (*varname == ':')
+		varname += 1;
+
+	return downcase_identifier(varname, strlen(varname), false, true);
+}
+
+/*
+ * CREATE PROCEDURE dbms_sql.variable_value(c int, name varchar2, INOUT value anyelement);
+ */
+Datum
+dbms_sql_variable_value(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	Datum		value;
+	bool		isnull;
+	Oid			targetTypeId;
+	TupleDesc	resulttupdesc;
+	HeapTuple	resulttuple;
+
+	c = get_cursor(fcinfo, true);
+
+	if (get_call_result_type(fcinfo, NULL, &resulttupdesc) == TYPEFUNC_COMPOSITE)
+	{
+		/* check target types */
+		if (resulttupdesc->natts != 1)
+			/* internal error, should not to be */
+			elog(ERROR, "unexpected number of result composite fields");
+
+		targetTypeId = get_fn_expr_argtype(fcinfo->flinfo, 2);
+		Assert((TupleDescAttr(resulttupdesc, 0))->atttypid == targetTypeId);
+	}
+	else
+		/* internal error, should not to be */
+		elog(ERROR, "unexpected function result type");
+
+	value = variable_value(c, get_variable_name(fcinfo), targetTypeId, &isnull);
+
+	resulttuple = heap_form_tuple(resulttupdesc, &value, &isnull);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(resulttuple));
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.variable_value_f(c int, name varchar2, value anyelement) RETURNS anyelement;
+ */
+Datum
+dbms_sql_variable_value_f(PG_FUNCTION_ARGS)
+{
+	CursorData *c;
+	Datum		value;
+	bool		isnull;
+
+	c = get_cursor(fcinfo, true);
+
+	value = variable_value(c, get_variable_name(fcinfo),
+						   get_fn_expr_argtype(fcinfo->flinfo, 2),
+						   &isnull);
+
+	if (isnull)
+		PG_RETURN_NULL();
+
+	PG_RETURN_DATUM(value);
+}
+
+/*
+ * Returns descriptor of record with all defined columns. The names
+ * of fields are taken from query. Array columns have array type.
+ */
+static TupleDesc
+get_values_tupdesc(CursorData *c)
+{
+	MemoryContext oldcxt;
+	TupleDesc	tupdesc;
+	int			i;
+
+	if (c->values_tupdesc)
+		return c->values_tupdesc;
+
+	oldcxt = MemoryContextSwitchTo(c->cursor_xact_cxt);
+
+#if PG_VERSION_NUM >= 120000
+
+	tupdesc = CreateTemplateTupleDesc(c->coltupdesc->natts);
+
+#else
+
+	tupdesc = CreateTemplateTupleDesc(c->coltupdesc->natts, false);
+
+#endif
+
+	for (i = 1; i <= c->coltupdesc->natts; i++)
+	{
+		ColumnData *col = get_col(c, i, false);
+		char		genname[32];
+		char	   *name;
+
+		if (i <= c->tupdesc->natts)
+			name = NameStr(TupleDescAttr(c->tupdesc, i - 1)->attname);
+		else
+		{
+			snprintf(genname, 32, "col%d", i);
+			name = genname;
+		}
+
+		TupleDescInitEntry(tupdesc, (AttrNumber) i, name,
+						   col->typarrayoid ? col->typarrayoid : col->typoid,
+						   col->typarrayoid ? -1 : col->typmod,
+						   0);
+	}
+
+	c->values_tupdesc = BlessTupleDesc(tupdesc);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return c->values_tupdesc;
+}
+
+/*
+ * CREATE FUNCTION dbms_sql.column_values(c int) RETURNS record;
+ * Returns values of all defined columns by one call.
+ */
+Datum
+dbms_sql_column_values(PG_FUNCTION_ARGS)
 {
 	CursorData *c;
-	Datum		value;
-	int			pos;
-	bool		isnull;
-	Oid			targetTypeId;
+	TupleDesc	tupdesc;
+	HeapTuple	tuple;
+	Datum	   *values;
+	bool	   *nulls;
 	MemoryContext	oldcxt;
-
-	if (SPI_connect() != SPI_OK_CONNECT)
-		elog(ERROR, "SPI_connact failed");
+	int			i;
 
 	c = get_cursor(fcinfo, true);
 
-	if (PG_ARGISNULL(1))
+	if (!c->executed)
 		ereport(ERROR,
-			    (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
-			     errmsg("column position (number) is NULL")));
+			    (errcode(ERRCODE_INVALID_CURSOR_STATE),
+			     errmsg("cursor is not executed")));
 
-	pos = PG_GETARG_INT32(1);
+	if (!c->tupdesc)
+		ereport(ERROR,
+			    (errcode(ERRCODE_INVALID_CURSOR_STATE),
+			     errmsg("cursor is not fetched")));
 
-	oldcxt = MemoryContextSwitchTo(c->result_cxt);
+	if (!c->coltupdesc)
+		ereport(ERROR,
+			    (errcode(ERRCODE_UNDEFINED_COLUMN),
+			     errmsg("no column is defined")));
 
-	targetTypeId = get_fn_expr_argtype(fcinfo->flinfo, 2);
+	tupdesc = get_values_tupdesc(c);
 
-	value = column_value(c, pos, targetTypeId, &isnull, true);
+	values = palloc(sizeof(Datum) * tupdesc->natts);
+	nulls = palloc(sizeof(bool) * tupdesc->natts);
 
-	SPI_finish();
+	oldcxt = MemoryContextSwitchTo(c->result_cxt);
+
+	for (i = 0; i < tupdesc->natts; i++)
+		values[i] = column_value(c, i + 1,
+								 TupleDescAttr(tupdesc, i)->atttypid,
+								 (Datum) 0, true,
+								 &nulls[i],
+								 false);
 
 	MemoryContextSwitchTo(oldcxt);
 
-	PG_RETURN_DATUM(value);
+	tuple = heap_form_tuple(tupdesc, values, nulls);
+
+	MemoryContextReset(c->result_cxt);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
 }
 
 /******************************************************************
@@ -1795,8 +6902,9 @@ dbms_sql_column_value_f(PG_FUNCTION_ARGS)
  */
 
 /*
- * It doesn't work for multibyte encodings, but same implementation
- * is in Postgres too.
+ * Returns true, when the byte can start an identifier. The bytes with high
+ * bit set are parts of multibyte chars, and all of them are accepted like
+ * Postgres's scanner does.
  */
 static bool
 is_identif(unsigned char c)
@@ -1805,12 +6913,116 @@ is_identif(unsigned char c)
 		return true;
 	else if (c >= 'A' && c <= 'Z')
 		return true;
-	else if (c >= 0200)
+	else if (c == '_')
+		return true;
+	else if (IS_HIGHBIT_SET(c))
 		return true;
 	else
 		return false;
 }
 
+/*
+ * Skip chars of identifier (or of name of bind variable). Multibyte chars
+ * are skipped as whole, so the identifier is never broken inside a char
+ * (the string is verified by text input, so pg_mblen cannot go over
+ * the end of string). The $ is allowed inside identifiers only.
+ */
+static char *
+skip_identif(char *str, bool allow_dollar)
+{
+	while (*str)
+	{
+		if (IS_HIGHBIT_SET(*str))
+			str += pg_mblen(str);
+		else if (is_identif(*str) ||
+				 isdigit((unsigned char) *str) ||
+				 (allow_dollar && *str == '$'))
+			str++;
+		else
+			break;
+	}
+
+	return str;
+}
+
+/*
+ * Skips plain text to the first char, where a bind variable, string,
+ * quoted identifier, dollar string or comment can start. The $ inside
+ * identifier and E of extended string literal are respected.
+ */
+static char *
+skip_plain_text(char *str)
+{
+	char	   *start = str;
+
+	while ((str = strpbrk(str, ":'\"$-/")) != NULL)
+	{
+		if (*str == '$' && str > start &&
+			(is_identif(str[-1]) || isdigit((unsigned char) str[-1])))
+		{
+			str++;
+			continue;
+		}
+
+		if (*str == '\'' && str > start &&
+			(str[-1] == 'e' || str[-1] == 'E') &&
+			(str - 1 == start ||
+			 !(is_identif(str[-2]) || isdigit((unsigned char) str[-2]))))
+			return str - 1;
+
+		return str;
+	}
+
+	return start + strlen(start);
+}
+
+/*
+ * Returns true, when the string contains the keyword (case insensitive).
+ * The keyword can be inside other word or string, so the result can be
+ * false positive only.
+ */
+static bool
+contains_keyword(char *str, const char *keyword)
+{
+	size_t		len = strlen(keyword);
+
+	for (; *str; str++)
+	{
+		if (pg_strncasecmp(str, keyword, len) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Returns pointer after closing quote of quoted string or identifier.
+ * The doubled quotes are part of value. The search of quote is done by
+ * strchr, that is much faster than a loop over bytes for long values.
+ */
+static char *
+skip_quoted(char *str, char quote, char **end)
+{
+	for (;;)
+	{
+		char	   *q = strchr(str, quote);
+
+		if (!q)
+		{
+			*end = str + strlen(str);
+			return *end;
+		}
+
+		if (q[1] != quote)
+		{
+			*end = q;
+			return q + 1;
+		}
+
+		str = q + 2;
+	}
+}
+
 /*
  * simple parser to detect :identif symbols in query
  */
@@ -1824,10 +7036,10 @@ next_token(char *str, char **start, size_t *len, TokenType *typ, char **sep, siz
 	}
 
 	/* reduce spaces */
-	if (*str == ' ')
+	if (isspace((unsigned char) *str))
 	{
 		*start = str++;
-		while (*str == ' ')
+		while (isspace((unsigned char) *str))
 			str++;
 
 		*typ = TOKEN_SPACES; *len = 1;
@@ -1835,90 +7047,89 @@ next_token(char *str, char **start, size_t *len, TokenType *typ, char **sep, siz
 	}
 
 	/* Postgres's dolar strings */
-	if (*str == '$' && (str[1] == '$' || is_identif(str[1]) || str[1] == '_'))
+	if (*str == '$' && (str[1] == '$' || is_identif(str[1])))
 	{
-		char	   *aux = str + 1;
+		char	   *aux = skip_identif(str + 1, false);
 		char	   *endstr;
-		bool		is_valid = false;
 		char	   *buffer;
 
-		/* try to find end of separator */
-		while (*aux)
-		{
-			if (*aux == '$')
-			{
-				is_valid = true;
-				aux++;
-				break;
-			}
-			else if (is_identif(*aux) ||
-					 isdigit(*aux) ||
-					 *aux == '_')
-			{
-				aux++;
-			}
-			else
-				break;
-		}
-
-		if (!is_valid)
+		if (*aux != '$')
 		{
 			*typ = TOKEN_OTHER; *len = 1;
 			*start = str;
 			return str + 1;
 		}
 
+		aux++;
+
 		/* now it looks like correct $ separator */
 		*start = aux; *sep = str; *seplen = aux - str; *typ = TOKEN_DOLAR_STR;
 
 		/* try to find second instance */
-		buffer = palloc(*seplen + 1);
-		strncpy(buffer, *sep, *seplen);
-		buffer[*seplen] = '\0';
-
+		buffer = pnstrdup(*sep, *seplen);
 		endstr = strstr(aux, buffer);
+		pfree(buffer);
+
 		if (endstr)
 		{
 			*len = endstr - *start;
 			return endstr + *seplen;
 		}
-		else
-		{
-			while (*aux)
-				aux++;
-			*len = aux - *start;
-			return aux;
-		}
 
-		return aux;
+		*len = strlen(aux);
+		return aux + *len;
 	}
 
-	/* Pair comments */
+	/* Pair comments, they can be nested like in Postgres */
 	if (*str == '/' && str[1] == '*')
 	{
+		int			depth = 1;
+
 		*start = str; str += 2;
-		while (*str)
+		while (depth > 0 && (str = strpbrk(str, "*/")) != NULL)
 		{
 			if (*str == '*' && str[1] == '/')
 			{
+				depth -= 1;
 				str += 2;
-				break;
 			}
-			str++;
+			else if (*str == '/' && str[1] == '*')
+			{
+				depth += 1;
+				str += 2;
+			}
+			else
+				str += 1;
 		}
+
+		if (!str)
+			str = *start + strlen(*start);
+
+		*typ = TOKEN_COMMENT; *len = str - *start;
+		return str;
+	}
+
+	/* Line comments */
+	if (*str == '-' && str[1] == '-')
+	{
+		*start = str;
+		str = strchr(str, '\n');
+		if (!str)
+			str = *start + strlen(*start);
+
 		*typ = TOKEN_COMMENT; *len = str - *start;
 		return str;
 	}
 
 	/* Number */
-	if (isdigit(*str) || (*str == '.' && isdigit(str[1])))
+	if (isdigit((unsigned char) *str) || (*str == '.' && isdigit((unsigned char) str[1])))
 	{
 		bool	point = *str == '.';
 
 		*start = str++;
 		while (*str)
 		{
-			if (isdigit(*str))
+			if (isdigit((unsigned char) *str))
 				str++;
 			else if (*str == '.' && !point)
 			{
@@ -1939,19 +7150,10 @@ next_token(char *str, char **start, size_t *len, TokenType *typ, char **sep, siz
 	}
 
 	/* Bind variable placeholder */
-	if (*str == ':' &&
-		(is_identif(str[1]) || str[1] == '_'))
+	if (*str == ':' && is_identif(str[1]))
 	{
-		*start = &str[1]; str += 2;
-		while (*str)
-		{
-			if (is_identif(*str) ||
-				isdigit(*str) ||
-				*str == '_')
-				str++;
-			else
-				break;
-		}
+		*start = &str[1];
+		str = skip_identif(str + 1, false);
 		*typ = TOKEN_BIND_VAR; *len = str - *start;
 		return str;
 	}
@@ -1960,82 +7162,49 @@ next_token(char *str, char **start, size_t *len, TokenType *typ, char **sep, siz
 	if ((*str == 'e' || *str == 'E') && str[1] == '\'')
 	{
 		*start = &str[2]; str += 2;
-		while (*str)
+		while ((str = strpbrk(str, "\\'")) != NULL)
 		{
 			if (*str == '\'')
 			{
 				*typ = TOKEN_EXT_STR; *len = str - *start;
 				return str + 1;
 			}
-			if (*str == '\\' && str[1] == '\'')
-				str += 2;
-			else if (*str == '\\' && str[1] == '\\')
-				str += 2;
-			else
-				str += 1;
+
+			/* skip escaped char */
+			str += str[1] ? 2 : 1;
 		}
 
-		*typ = TOKEN_EXT_STR; *len = str - *start;
-		return str;
+		*typ = TOKEN_EXT_STR; *len = strlen(*start);
+		return *start + *len;
 	}
 
 	/* String literal */
 	if (*str == '\'')
 	{
-		*start = &str[1]; str += 1;
-		while (*str)
-		{
-			if (*str == '\'')
-			{
-				if (str[1] != '\'')
-				{
-					*typ = TOKEN_STR; *len = str - *start;
-					return str + 1;
-				}
-				str += 2;
-			}
-			else
-				str += 1;
-		}
-		*typ = TOKEN_STR; *len = str - *start;
+		char	   *end;
+
+		*start = &str[1];
+		str = skip_quoted(str + 1, '\'', &end);
+		*typ = TOKEN_STR; *len = end - *start;
 		return str;
 	}
 
 	/* Quoted identifier */
 	if (*str == '"')
 	{
-		*start = &str[1]; str += 1;
-		while (*str)
-		{
-			if (*str == '"')
-			{
-				if (str[1] != '"')
-				{
-					*typ = TOKEN_QIDENTIF; *len = str - *start;
-					return str + 1;
-				}
-				str += 2;
-			}
-			else
-				str += 1;
-		}
-		*typ = TOKEN_QIDENTIF; *len = str - *start;
+		char	   *end;
+
+		*start = &str[1];
+		str = skip_quoted(str + 1, '"', &end);
+		*typ = TOKEN_QIDENTIF; *len = end - *start;
 		return str;
 	}
 
-	/* Identifiers */
-	if (is_identif(*str) || *str == '_')
+	/* Identifiers and keywords */
+	if (is_identif(*str))
 	{
-		*start = str++;
-		while (*str)
-		{
-			if (is_identif(*str) ||
-				isdigit(*str) ||
-				*str == '_')
-				str++;
-			else
-				break;
-		}
+		*start = str;
+		str = skip_identif(str, true);
 		*typ = TOKEN_IDENTIF; *len = str - *start;
 		return str;
 	}
@@ -2045,6 +7214,127 @@ next_token(char *str, char **start, size_t *len, TokenType *typ, char **sep, siz
 	return str + 1;
 }
 
+static bool
+is_keyword(TokenType typ, char *start, size_t len, const char *keyword)
+{
+	return typ == TOKEN_IDENTIF &&
+		   strlen(keyword) == len &&
+		   pg_strncasecmp(start, keyword, len) == 0;
+}
+
+static bool
+is_char(TokenType typ, char *start, char c)
+{
+	return typ == TOKEN_OTHER && *start == c;
+}
+
+/*
+ * Detection of simple INSERT INTO ... VALUES (...) statements. The routine
+ * is called for any token. Offset is a position of token in parsed query,
+ * next_offset is a position after token.
+ */
+static ValuesClauseState
+values_clause_step(ValuesClauseState state,
+				   int *depth,
+				   ValuesClauseInfo *vci,
+				   TokenType typ,
+				   char *start,
+				   size_t len,
+				   int offset,
+				   int next_offset)
+{
+	if (state == VALUES_STATE_NONE)
+		return state;
+
+	/* spaces and comments are not significant */
+	if (typ == TOKEN_SPACES || typ == TOKEN_COMMENT || typ == TOKEN_NONE ||
+		(typ == TOKEN_OTHER && isspace((unsigned char) *start)))
+		return state;
+
+	switch (state)
+	{
+		case VALUES_STATE_START:
+			if (is_keyword(typ, start, len, "insert"))
+				return VALUES_STATE_TARGET;
+			break;
+
+		case VALUES_STATE_TARGET:
+			if (is_char(typ, start, '('))
+				*depth += 1;
+			else if (is_char(typ, start, ')'))
+				*depth -= 1;
+			else if (*depth == 0)
+			{
+				if (is_keyword(typ, start, len, "values"))
+				{
+					vci->values = offset;
+					return VALUES_STATE_VALUES;
+				}
+				else if (is_keyword(typ, start, len, "select") ||
+						 is_keyword(typ, start, len, "default"))
+					break;
+			}
+			return state;
+
+		case VALUES_STATE_VALUES:
+			if (is_char(typ, start, '('))
+			{
+				*depth = 1;
+				vci->start = next_offset;
+				vci->only_variables = true;
+				return VALUES_STATE_LIST;
+			}
+			break;
+
+		case VALUES_STATE_LIST:
+			/*
+			 * DEFAULT cannot be used in SELECT list, and subqueries can
+			 * see rows inserted by previous rows in row by row mode.
+			 */
+			if (is_keyword(typ, start, len, "default") ||
+				is_keyword(typ, start, len, "select"))
+				break;
+
+			if (is_char(typ, start, '('))
+				*depth += 1;
+			else if (is_char(typ, start, ')'))
+			{
+				*depth -= 1;
+				if (*depth == 0)
+				{
+					vci->end = offset;
+					return VALUES_STATE_TAIL;
+				}
+			}
+
+			/* direct load is possible only for list of bind variables */
+			if (*depth != 1 ||
+				!(typ == TOKEN_BIND_VAR || is_char(typ, start, ',')))
+				vci->only_variables = false;
+
+			return state;
+
+		case VALUES_STATE_TAIL:
+			if (is_char(typ, start, ';'))
+				return VALUES_STATE_END;
+			else if (is_keyword(typ, start, len, "returning"))
+				return VALUES_STATE_RETURNING;
+			break;
+
+		case VALUES_STATE_RETURNING:
+			if (is_char(typ, start, ';'))
+				return VALUES_STATE_END;
+			return state;
+
+		case VALUES_STATE_END:
+		case VALUES_STATE_NONE:
+			break;
+	}
+
+	/* multi rows VALUES, ON CONFLICT clause, ... */
+	return VALUES_STATE_NONE;
+}
+
 /*
  * CREATE PROCEDURE dbms_sql.describe_columns(c int, OUT col_cnt int, OUT desc_t dbms_sql.desc_rec[])
  *
@@ -2065,26 +7355,18 @@ dbms_sql_describe_columns(PG_FUNCTION_ARGS)
 	Oid			desc_rec_typid;
 	Oid		   *types = NULL;
 	ArrayBuildState *abuilder;
-	SPIPlanPtr		plan;
-	CachedPlanSource *plansource = NULL;
+	SPIPlanPtr		plan = NULL;
 	int			ncolumns = 0;
 	int			rc;
 	int			i = 0;
 	bool		nonatomic;
 	MemoryContext callercxt = CurrentMemoryContext;
+	MemoryContext oldcxt;
 
 	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
 		elog(ERROR, "return type must be a row type");
 
 	arraytypid = TupleDescAttr(tupdesc, 1)->atttypid;
-	desc_rec_typid = get_element_type(arraytypid);
-
-	if (!OidIsValid(desc_rec_typid))
-		elog(ERROR, "second output field must be an array");
-
-	desc_rec_tupdesc = lookup_rowtype_tupdesc_copy(desc_rec_typid, -1);
-
-	abuilder = initArrayResult(desc_rec_typid, callercxt, true);
 
 	c = get_cursor(fcinfo, true);
 
@@ -2108,6 +7390,37 @@ dbms_sql_describe_columns(PG_FUNCTION_ARGS)
 		}
 	}
 
+	/*
+	 * The result is cached until the plan of cursor is changed or
+	 * invalidated.
+	 */
+	if (c->desc_columns &&
+		c->desc_arraytypid == arraytypid &&
+		c->desc_plan == c->plan &&
+		plan_is_usable(c->plan, c->nvariables, types,
+					   get_cursor_options(c)) &&
+		SPI_plan_is_valid(c->plan->plan))
+	{
+		values[0] = Int32GetDatum(c->desc_ncolumns);
+		nulls[0] = false;
+
+		values[1] = c->desc_columns;
+		nulls[1] = false;
+
+		tuple = heap_form_tuple(tupdesc, values, nulls);
+
+		PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+	}
+
+	desc_rec_typid = get_element_type(arraytypid);
+
+	if (!OidIsValid(desc_rec_typid))
+		elog(ERROR, "second output field must be an array");
+
+	desc_rec_tupdesc = lookup_rowtype_tupdesc_copy(desc_rec_typid, -1);
+
+	abuilder = initArrayResult(desc_rec_typid, callercxt, true);
+
 	/*
 	 * Connect to SPI manager
 	 */
@@ -2118,15 +7431,53 @@ dbms_sql_describe_columns(PG_FUNCTION_ARGS)
 	if ((rc = SPI_connect_ext(nonatomic ? SPI_OPT_NONATOMIC : 0)) != SPI_OK_CONNECT)
 		elog(ERROR, "SPI_connect failed: %s", SPI_result_code_string(rc));
 
-	plan = SPI_prepare(c->parsed_query, c->nvariables, types);
-	if (!plan || plan->magic != _SPI_PLAN_MAGIC)
-		elog(ERROR, "plan is not valid");
+	/*
+	 * The result of executed query is described by its portal. Else the
+	 * cursor's plan (it is used by execute later) is prepared. Only when
+	 * this plan is invalidated, then temporary plan is used.
+	 */
+	c->desc_plan = NULL;
 
-	if (list_length(plan->plancache_list) != 1)
-		elog(ERROR, "plan is not single execution plany");
+	if (get_portal(c) && c->portal->tupDesc)
+	{
+		cursor_tupdesc = c->portal->tupDesc;
+		c->desc_plan = c->plan;
+	}
+	else if (c->drained_tuptable)
+	{
+		cursor_tupdesc = c->drained_tuptable->tupdesc;
+		c->desc_plan = c->plan;
+	}
+	else
+	{
+		CachedPlanSource *plansource;
 
-	plansource = (CachedPlanSource *) linitial(plan->plancache_list);
-	cursor_tupdesc = plansource->resultDesc;
+		plan = prepare_plan(c, types);
+		if (SPI_plan_is_valid(plan))
+		{
+			/* cursor's plan is released by cursor */
+			c->desc_plan = c->plan;
+		}
+		else
+			plan = SPI_prepare(c->parsed_query, c->nvariables, types);
+
+		if (!plan || plan->magic != _SPI_PLAN_MAGIC)
+			elog(ERROR, "plan is not valid");
+
+		if (list_length(plan->plancache_list) != 1)
+			elog(ERROR, "plan is not single execution plany");
+
+		plansource = (CachedPlanSource *) linitial(plan->plancache_list);
+		cursor_tupdesc = plansource->resultDesc;
+
+		if (c->desc_plan)
+			plan = NULL;
+	}
+
+	if (!cursor_tupdesc)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("statement doesn't return rows")));
 
 	ncolumns = cursor_tupdesc->natts;
 
@@ -2211,7 +7562,8 @@ dbms_sql_describe_columns(PG_FUNCTION_ARGS)
 		ReleaseSysCache(tp);
 	}
 
-	SPI_freeplan(plan);
+	if (plan)
+		SPI_freeplan(plan);
 
 	if ((rc = SPI_finish()) != SPI_OK_FINISH)
 		elog(ERROR, "SPI_finish failed: %s", SPI_result_code_string(rc));
@@ -2227,6 +7579,21 @@ dbms_sql_describe_columns(PG_FUNCTION_ARGS)
 	values[1] = makeArrayResult(abuilder, callercxt);
 	nulls[1] = false;
 
+	/* save result for next calls */
+	if (c->desc_plan)
+	{
+		oldcxt = MemoryContextSwitchTo(c->cursor_cxt);
+
+		if (c->desc_columns)
+			pfree(DatumGetPointer(c->desc_columns));
+
+		c->desc_columns = datumCopy(values[1], false, -1);
+		c->desc_ncolumns = ncolumns;
+		c->desc_arraytypid = arraytypid;
+
+		MemoryContextSwitchTo(oldcxt);
+	}
+
 	tuple = heap_form_tuple(tupdesc, values, nulls);
 
 	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
@@ -155,3 +155,961 @@ begin
   call dbms_sql.close_cursor(c);
 end;
 $$;
+
+-- reexecution of cursor with different binds
+do $$
+declare
+  c int;
+  intval int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i from generate_series(1, :n) g(i)');
+  call dbms_sql.define_column(c, 1, intval);
+  for n in 1..3
+  loop
+    if n < 3 then
+      call dbms_sql.bind_variable(c, 'n', n);
+    else
+      call dbms_sql.bind_variable(c, 'n', n::bigint);
+    end if;
+    perform dbms_sql.execute(c);
+    while dbms_sql.fetch_rows(c) > 0
+    loop
+      call dbms_sql.column_value(c, 1, intval);
+      raise notice 'n: %, i: %', n, intval;
+    end loop;
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- set based and row by row execution of bulk insert
+set dbms_sql.set_based_insert to on;
+do $$
+declare
+  c int;
+  a int[] := ARRAY[1, 2, 3, 4, 5];
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo values(:a, :b, :a * 10)');
+  call dbms_sql.bind_array(c, 'a', a, 2, 4);
+  call dbms_sql.bind_variable(c, 'b', 'Ahoj');
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+set dbms_sql.set_based_insert to off;
+do $$
+declare
+  c int;
+  a int[] := ARRAY[1, 2, 3, 4, 5];
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo values(:a, :b, :a * 10)');
+  call dbms_sql.bind_array(c, 'a', a, 2, 4);
+  call dbms_sql.bind_variable(c, 'b', 'Ahoj');
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+reset dbms_sql.set_based_insert;
+select * from foo;
+truncate foo;
+
+-- cached parsing of same query in more cursors
+set dbms_sql.parse_cache_size to 1;
+do $$
+declare
+  c1 int;
+  c2 int;
+  r int;
+begin
+  c1 := dbms_sql.open_cursor();
+  c2 := dbms_sql.open_cursor();
+  call dbms_sql.parse(c1, 'select :a * 10 + :b');
+  call dbms_sql.parse(c2, 'select :a * 10 + :b');
+  call dbms_sql.bind_variable(c2, 'b', 2);
+  call dbms_sql.bind_variable(c2, 'a', 1);
+  call dbms_sql.define_column(c2, 1, r);
+  perform dbms_sql.execute_and_fetch(c2);
+  call dbms_sql.column_value(c2, 1, r);
+  raise notice 'r: %', r;
+  -- the first query is removed from cache
+  call dbms_sql.parse(c1, 'select :b * 10 + :a');
+  call dbms_sql.parse(c2, 'select :a * 10 + :b');
+  call dbms_sql.bind_variable(c2, 'a', 3);
+  call dbms_sql.bind_variable(c2, 'b', 4);
+  call dbms_sql.define_column(c2, 1, r);
+  perform dbms_sql.execute_and_fetch(c2);
+  call dbms_sql.column_value(c2, 1, r);
+  raise notice 'r: %', r;
+  call dbms_sql.close_cursor(c1);
+  call dbms_sql.close_cursor(c2);
+end;
+$$;
+reset dbms_sql.parse_cache_size;
+
+-- reparsed query reuses saved plan
+do $$
+declare
+  c1 int;
+  c2 int;
+  r int;
+  s1 record;
+  s2 record;
+begin
+  s1 := dbms_sql.plan_cache_stats();
+  c1 := dbms_sql.open_cursor();
+  c2 := dbms_sql.open_cursor();
+  for i in 1..3
+  loop
+    call dbms_sql.parse(c1, 'select :x + 100');
+    call dbms_sql.bind_variable(c1, 'x', i);
+    call dbms_sql.define_column(c1, 1, r);
+    perform dbms_sql.execute_and_fetch(c1);
+    call dbms_sql.column_value(c1, 1, r);
+    raise notice 'r: %', r;
+  end loop;
+  call dbms_sql.parse(c2, 'select :x + 100');
+  call dbms_sql.bind_variable(c2, 'x', 10);
+  call dbms_sql.define_column(c2, 1, r);
+  perform dbms_sql.execute_and_fetch(c2);
+  call dbms_sql.column_value(c2, 1, r);
+  raise notice 'r: %', r;
+  s2 := dbms_sql.plan_cache_stats();
+  raise notice 'hits: %, misses: %', s2.hits - s1.hits, s2.misses - s1.misses;
+  call dbms_sql.close_cursor(c1);
+  call dbms_sql.close_cursor(c2);
+end;
+$$;
+
+-- fetch with small prefetch buffer
+set dbms_sql.prefetch_bytes to '1kB';
+do $$
+declare
+  c int;
+  i int;
+  t text;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.set_prefetch_rows(c, 3);
+  call dbms_sql.parse(c, 'select i, repeat(''x'', 300) from generate_series(1, 7) g(i)');
+  call dbms_sql.define_column(c, 1, i);
+  call dbms_sql.define_column(c, 2, t);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    call dbms_sql.column_value(c, 1, i);
+    call dbms_sql.column_value(c, 2, t);
+    raise notice 'i: %, len: %', i, length(t);
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+reset dbms_sql.prefetch_bytes;
+
+-- read all columns by one call
+do $$
+declare
+  c int;
+  r record;
+  i int;
+  t text;
+  a int[];
+  b text[];
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i, ''Ahoj'' || i as t from generate_series(1, 3) g(i)');
+  call dbms_sql.define_column(c, 1, i);
+  call dbms_sql.define_column(c, 2, t);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    r := dbms_sql.column_values(c);
+    raise notice '% %', r, r.t;
+  end loop;
+  call dbms_sql.parse(c, 'select i, ''Ahoj'' || i as t from generate_series(1, 3) g(i)');
+  call dbms_sql.define_array(c, 1, a, 2, 1);
+  call dbms_sql.define_array(c, 2, b, 2, 1);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    r := dbms_sql.column_values(c);
+    raise notice '%', r;
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- stream not fetched rows to query
+do $$
+declare
+  c int;
+  i int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i, i * 10 from generate_series(1, 5) g(i)');
+  call dbms_sql.define_column(c, 1, i);
+  call dbms_sql.define_column(c, 2, i);
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  call dbms_sql.column_value(c, 1, i);
+  raise notice 'i: %', i;
+  insert into foo(a, c) select * from dbms_sql.fetch_all(c) AS (a int, c numeric);
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select * from foo;
+truncate foo;
+
+-- chunked bulk insert from one array
+do $$
+declare
+  c int;
+  a int[] := array(select generate_series(1, 10));
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo(a) values(:a)');
+  for i in 0..2
+  loop
+    call dbms_sql.bind_array(c, 'a', a, i * 4 + 1, i * 4 + 4);
+    raise notice 'inserted rows %', dbms_sql.execute(c);
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select a from foo;
+truncate foo;
+
+-- statement with many variables
+do $$
+declare
+  c int;
+  r int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select ' || (select string_agg(':v' || i, ' + ') from generate_series(1, 20) g(i)));
+  for i in reverse 20..1
+  loop
+    call dbms_sql.bind_variable(c, 'v' || i, i);
+  end loop;
+  call dbms_sql.define_column(c, 1, r);
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  call dbms_sql.column_value(c, 1, r);
+  raise notice 'result: %', r;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- performance counters
+do $$
+declare
+  c int;
+  i int;
+  s record;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i * 2 from generate_series(1, :n) g(i)');
+  call dbms_sql.bind_variable(c, 'n', 5);
+  call dbms_sql.define_column(c, 1, i);
+  for j in 1..2
+  loop
+    perform dbms_sql.execute(c);
+    while dbms_sql.fetch_rows(c) > 0
+    loop
+      call dbms_sql.column_value(c, 1, i);
+    end loop;
+  end loop;
+  select * into s from dbms_sql.cursor_stats() where cursor_id = c;
+  raise notice 'parse: %, plan hits: %, plan misses: %, execute: %, fetch: %, rows: %, cast misses: %',
+    s.parse_calls, s.plan_hits, s.plan_misses, s.execute_calls, s.fetch_calls, s.fetched_rows, s.cast_misses;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select parse_calls > 0 as parsed, execute_calls > 0 as executed from dbms_sql.session_stats();
+
+-- the result is read by one execution
+do $$
+declare
+  c int;
+  i int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i from generate_series(1, 3) g(i)');
+  call dbms_sql.set_parallel(c, true);
+  call dbms_sql.define_column(c, 1, i);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    call dbms_sql.column_value(c, 1, i);
+    raise notice 'i: %', i;
+  end loop;
+  raise notice 'fetched rows: %', dbms_sql.fetch_rows(c);
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- parallel plan is used only when parallel execution is enabled
+create table foo_par as select i as a from generate_series(1, 10000) g(i);
+analyze foo_par;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+do $$
+declare
+  c int;
+  n bigint;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select count(*) from foo_par');
+  call dbms_sql.define_column(c, 1, n);
+  raise notice 'parallel plan: %',
+    exists(select * from dbms_sql.explain(c) e where e like '%Gather%');
+  call dbms_sql.set_parallel(c, true);
+  raise notice 'parallel plan: %',
+    exists(select * from dbms_sql.explain(c) e where e like '%Gather%');
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  call dbms_sql.column_value(c, 1, n);
+  raise notice 'count: %', n;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+drop table foo_par;
+
+-- repeated describe of parsed and executed cursor
+do $$
+declare
+  c int;
+  n int;
+  d dbms_sql.desc_rec[];
+  r dbms_sql.desc_rec;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i, ''Ahoj'' || i as t from generate_series(1, :n) g(i)');
+  call dbms_sql.bind_variable(c, 'n', 3);
+  for j in 1..2
+  loop
+    call dbms_sql.describe_columns(c, n, d);
+    raise notice 'columns: %', n;
+  end loop;
+  call dbms_sql.define_column(c, 1, n);
+  call dbms_sql.define_column(c, 2, r.col_name);
+  perform dbms_sql.execute(c);
+  call dbms_sql.describe_columns(c, n, d);
+  foreach r in array d
+  loop
+    raise notice '% %', r.col_name, r.col_type::regtype;
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- holdable cursor survives commit
+do $$
+declare
+  c int;
+  i int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i from generate_series(1, 3) g(i)');
+  call dbms_sql.set_holdable(c, true);
+  call dbms_sql.define_column(c, 1, i);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    call dbms_sql.column_value(c, 1, i);
+    raise notice 'i: %', i;
+    commit;
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- memory usage and limit
+do $$
+declare
+  c int;
+  i int;
+  r record;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i from generate_series(1, 10) g(i)');
+  call dbms_sql.define_column(c, 1, i);
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  for r in select context from dbms_sql.memory_usage() where cursor_id = c
+  loop
+    raise notice 'context: %', r.context;
+  end loop;
+  call dbms_sql.parse(c, 'insert into foo(a) values(:a)');
+  perform set_config('dbms_sql.max_memory', '64kB', true);
+  begin
+    call dbms_sql.bind_array(c, 'a', array(select generate_series(1, 100000)));
+  exception when program_limit_exceeded then
+    raise notice 'memory limit exceeded';
+  end;
+  perform set_config('dbms_sql.max_memory', '0', true);
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- returning into
+do $$
+declare
+  c int;
+  r int[];
+  n numeric;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo(a) values(:a) returning a * 10 into :r');
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3]);
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.variable_value(c, 'r', r);
+  raise notice 'r: %', r;
+  call dbms_sql.parse(c, 'update foo set c = a + 0.5 where a = :a returning c into :c');
+  call dbms_sql.bind_variable(c, 'a', 2);
+  perform dbms_sql.execute(c);
+  n := dbms_sql.variable_value_f(c, 'c', n);
+  raise notice 'n: %', n;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+truncate foo;
+
+-- direct load of bulk insert
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo values(:a, :b, :c)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array(select generate_series(1, 2500)));
+  call dbms_sql.bind_array(c, 'b', array(select 'row ' || i from generate_series(1, 2500) g(i)));
+  call dbms_sql.bind_array(c, 'c', array(select i * 0.1 from generate_series(1, 2500) g(i)));
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.parse(c, 'insert into foo(c, a) values(:c, :a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3, 4, 5], 2, 3);
+  call dbms_sql.bind_variable(c, 'c', 10);
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.parse(c, 'insert into foo(a) values(:a + 1)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'direct load is not supported';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select count(*), sum(a), count(b), sum(c) from foo;
+truncate foo;
+
+-- comments, strings and $ identifiers are not searched for bind variables
+do $$
+declare
+  c int;
+  r int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, e'select :a + x$y$z as "res:e" -- isn''t :b\n'
+                         '  from (select 1 as x$y$z, e''\\'':f'' as s) s$ /* nested /* :c */ :d */');
+  call dbms_sql.bind_variable(c, 'a', 10);
+  call dbms_sql.define_column(c, 1, r);
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  call dbms_sql.column_value(c, 1, r);
+  raise notice 'r: %', r;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- parsed query is passed to refcursor and back
+do $$
+declare
+  c int;
+  rc refcursor;
+  i int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i from generate_series(1, 4) g(i) where i > :n');
+  call dbms_sql.bind_variable(c, 'n', 1);
+  rc := dbms_sql.to_refcursor(c);
+  raise notice 'is open: %', dbms_sql.is_open(c);
+  fetch rc into i;
+  raise notice 'fetched by refcursor: %', i;
+  c := dbms_sql.to_cursor_number(rc);
+  call dbms_sql.define_column(c, 1, i);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    call dbms_sql.column_value(c, 1, i);
+    raise notice 'fetched by dbms_sql: %', i;
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- casts between common types
+do $$
+declare
+  c int;
+  a int;
+  b numeric;
+  t text;
+  n int8;
+  s int2;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select 10::int8, 20, 30, ''40''::text, 70000');
+  call dbms_sql.define_column(c, 1, a);
+  call dbms_sql.define_column(c, 2, b);
+  call dbms_sql.define_column(c, 3, t);
+  call dbms_sql.define_column(c, 4, n);
+  call dbms_sql.define_column(c, 5, s);
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  call dbms_sql.column_value(c, 1, a);
+  call dbms_sql.column_value(c, 2, b);
+  call dbms_sql.column_value(c, 3, t);
+  call dbms_sql.column_value(c, 4, n);
+  raise notice '% % % %', a, b, t, n;
+  begin
+    call dbms_sql.column_value(c, 5, s);
+  exception when numeric_value_out_of_range then
+    raise notice 'smallint out of range';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- accumulate fetched batches to target arrays
+do $$
+declare
+  c int;
+  a int[];
+  b text[];
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i, ''A'' || i from generate_series(1, 7) g(i)');
+  call dbms_sql.define_array(c, 1, a, 3, 2, accumulate => true);
+  call dbms_sql.define_array(c, 2, b, 3, 2, accumulate => true);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    a := dbms_sql.column_value_f(c, 1, a);
+    call dbms_sql.column_value(c, 2, b);
+  end loop;
+  raise notice '%', a;
+  raise notice '%', b;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- keyed lookups by one execution of query with array bind
+do $$
+declare
+  c int;
+  a int;
+  b int;
+  idx int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i, i * 10 from generate_series(1, 7) g(i) where i = :k order by i');
+  call dbms_sql.bind_array(c, 'k', ARRAY[3, 5, 5, 9]);
+  call dbms_sql.define_column(c, 1, a);
+  call dbms_sql.define_column(c, 2, b);
+  call dbms_sql.define_column(c, 3, idx);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    call dbms_sql.column_value(c, 1, a);
+    call dbms_sql.column_value(c, 2, b);
+    call dbms_sql.column_value(c, 3, idx);
+    raise notice 'index: %, a: %, b: %', idx, a, b;
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- plan of statement with current binds
+do $$
+declare
+  c int;
+  l text;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select i from generate_series(1, 7) g(i) where i = :k');
+  call dbms_sql.bind_variable(c, 'k', 3);
+  for l in select * from dbms_sql.explain(c)
+  loop
+    raise notice '%', regexp_replace(l, '\s+\(cost=.*\)', '');
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- direct load refuses too long strings like INSERT
+create table foo_dl(a varchar(3));
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_dl values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array['abc', 'abcd']);
+  begin
+    perform dbms_sql.execute(c);
+  exception when string_data_right_truncation then
+    raise notice 'value too long';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select count(*) from foo_dl;
+drop table foo_dl;
+
+-- direct load refuses values of identity columns and OVERRIDING clause
+create table foo_dl(id int generated always as identity, a int);
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_dl(id, a) values(:id, :a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'id', array[1, 2]);
+  call dbms_sql.bind_array(c, 'a', array[10, 20]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when generated_always then
+    raise notice 'identity column is refused';
+  end;
+  call dbms_sql.parse(c, 'insert into foo_dl overriding system value values(:id, :a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'id', array[1, 2]);
+  call dbms_sql.bind_array(c, 'a', array[10, 20]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'overriding clause is refused';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+drop table foo_dl;
+
+-- direct load checks column privileges like INSERT
+create table foo_dl(a int, b int);
+create role regress_dbms_sql_dl;
+grant usage on schema dbms_sql to regress_dbms_sql_dl;
+grant insert(a) on foo_dl to regress_dbms_sql_dl;
+set role regress_dbms_sql_dl;
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_dl(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3]);
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.parse(c, 'insert into foo_dl(a, b) values(:a, :b)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3]);
+  call dbms_sql.bind_array(c, 'b', array[1, 2, 3]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when insufficient_privilege then
+    raise notice 'insert on column b is not granted';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+reset role;
+select count(*), count(b) from foo_dl;
+drop table foo_dl;
+revoke usage on schema dbms_sql from regress_dbms_sql_dl;
+drop role regress_dbms_sql_dl;
+
+-- direct load checks constraints and refuses tables with triggers
+create table foo_dl(a int primary key, b int not null check (b > 0));
+create table foo_dl_fk(a int references foo_dl(a));
+create function foo_dl_trg() returns trigger as $$ begin return new; end $$ language plpgsql;
+create table foo_dl_trg(a int);
+create trigger foo_dl_trg before insert on foo_dl_trg for each row execute function foo_dl_trg();
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_dl(a, b) values(:a, :b)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  call dbms_sql.bind_array(c, 'b', array[10, null]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when not_null_violation then
+    raise notice 'not null constraint is checked';
+  end;
+  call dbms_sql.bind_array(c, 'b', array[10, -1]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when check_violation then
+    raise notice 'check constraint is checked';
+  end;
+  call dbms_sql.bind_array(c, 'a', array[1, 1]);
+  call dbms_sql.bind_array(c, 'b', array[10, 20]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when unique_violation then
+    raise notice 'unique index is checked';
+  end;
+  call dbms_sql.parse(c, 'insert into foo_dl_fk(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'table with foreign key is refused';
+  end;
+  call dbms_sql.parse(c, 'insert into foo_dl_trg(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'table with trigger is refused';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select count(*) from foo_dl;
+drop table foo_dl_trg;
+drop function foo_dl_trg();
+drop table foo_dl_fk;
+drop table foo_dl;
+
+-- binding of RETURNING INTO variables is ignored
+create table foo_ri(a int);
+do $$
+declare
+  c int;
+  r int;
+  ra int[];
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_ri values(:a) returning a into :r');
+  call dbms_sql.bind_variable(c, 'a', 10);
+  call dbms_sql.bind_variable(c, 'r', r);
+  perform dbms_sql.execute(c);
+  call dbms_sql.variable_value(c, 'r', r);
+  raise notice 'r: %', r;
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  call dbms_sql.bind_array(c, 'r', ra);
+  perform dbms_sql.execute(c);
+  call dbms_sql.variable_value(c, 'r', ra);
+  raise notice 'ra: %', ra;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+drop table foo_ri;
+
+-- variables of failed parse are not used
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  begin
+    call dbms_sql.parse(c, 'insert into foo values(:a) returning a into :r, 10');
+  exception when syntax_error then
+    raise notice 'syntax error in RETURNING INTO clause';
+  end;
+  call dbms_sql.parse(c, 'insert into foo values(:b)');
+  begin
+    call dbms_sql.bind_variable(c, 'a', 10);
+  exception when undefined_parameter then
+    raise notice 'variable a is not used';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- arrays used in RETURNING clause are evaluated row by row
+create table foo_ra(a int);
+set dbms_sql.set_based_insert to on;
+do $$
+declare
+  c int;
+  r int[];
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_ra values(:a) returning a + :b into :r');
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3]);
+  call dbms_sql.bind_array(c, 'b', array[10, 20, 30]);
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.variable_value(c, 'r', r);
+  raise notice 'r: %', r;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+reset dbms_sql.set_based_insert;
+drop table foo_ra;
+
+-- statistics of statements require shared_preload_libraries,
+-- see "make check-statements"
+do $$
+begin
+  perform * from dbms_sql.statements;
+exception when object_not_in_prerequisite_state then
+  raise notice 'statistics of statements are not available';
+end;
+$$;
+
+-- options of cursor are kept by next parse
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.parse(c, 'insert into foo(a) values(:a)');
+  call dbms_sql.parse(c, 'insert into foo(a, b) values(:a, :b)');
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  call dbms_sql.bind_array(c, 'b', array['a', 'b']);
+  begin
+    perform * from dbms_sql.explain(c);
+  exception when feature_not_supported then
+    raise notice 'direct load is used';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- column position is limited by maximal number of columns
+do $$
+declare
+  c int;
+  i int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select 1');
+  begin
+    call dbms_sql.define_column(c, 1000000000, i);
+  exception when invalid_parameter_value then
+    raise notice 'too high column position';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+-- direct load refuses rules, and domains with default or constraints of not listed columns
+create domain foo_dl_dom_def as int default 10;
+create domain foo_dl_dom_nn as int not null;
+create domain foo_dl_dom as int;
+create table foo_dl_dom_def_t(a int, b foo_dl_dom_def);
+create table foo_dl_dom_nn_t(a int, b foo_dl_dom_nn);
+create table foo_dl_dom_t(a int, b foo_dl_dom);
+create table foo_dl_rule(a int);
+create rule foo_dl_rule as on insert to foo_dl_rule do also notify foo_dl_rule;
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_dl_dom_def_t(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'domain with default is refused';
+  end;
+  call dbms_sql.parse(c, 'insert into foo_dl_dom_nn_t(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'domain with not null constraint is refused';
+  end;
+  call dbms_sql.parse(c, 'insert into foo_dl_rule(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  begin
+    perform dbms_sql.execute(c);
+  exception when feature_not_supported then
+    raise notice 'table with rule is refused';
+  end;
+  call dbms_sql.parse(c, 'insert into foo_dl_dom_t(a) values(:a)');
+  call dbms_sql.set_direct_load(c, true);
+  call dbms_sql.bind_array(c, 'a', array[1, 2]);
+  raise notice 'inserted rows %', dbms_sql.execute(c);
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select count(*) from foo_dl_dom_t where b is null;
+drop table foo_dl_dom_def_t;
+drop table foo_dl_dom_nn_t;
+drop table foo_dl_dom_t;
+drop table foo_dl_rule;
+drop domain foo_dl_dom_def;
+drop domain foo_dl_dom_nn;
+drop domain foo_dl_dom;
+
+-- explain analyze executes the statement, so it is refused for DML
+create table foo_ea(a int);
+do $$
+declare
+  c int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into foo_ea(a) values(:a)');
+  call dbms_sql.bind_variable(c, 'a', 1);
+  begin
+    perform * from dbms_sql.explain(c, true);
+  exception when feature_not_supported then
+    raise notice 'explain analyze of insert is refused';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+select count(*) from foo_ea;
+drop table foo_ea;
+
+-- memory limit of parallel cursor, parallel cursor cannot be passed as refcursor
+do $$
+declare
+  c int;
+  i int;
+  rc refcursor;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.set_parallel(c, true);
+  call dbms_sql.parse(c, 'select i from generate_series(1, 100000) g(i)');
+  call dbms_sql.define_column(c, 1, i);
+  perform set_config('dbms_sql.max_memory', '64kB', true);
+  begin
+    perform dbms_sql.execute(c);
+  exception when program_limit_exceeded then
+    raise notice 'memory limit exceeded';
+  end;
+  perform set_config('dbms_sql.max_memory', '0', true);
+  begin
+    rc := dbms_sql.to_refcursor(c);
+  exception when feature_not_supported then
+    raise notice 'parallel cursor cannot be passed as refcursor';
+  end;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
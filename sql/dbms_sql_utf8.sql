@@ -0,0 +1,28 @@
+/*
+ * This test uses multibyte identifiers and names of bind variables,
+ * so it must be run in a database with UTF-8 encoding.
+ */
+SELECT getdatabaseencoding() <> 'UTF8' AS skip_test \gset
+\if :skip_test
+\quit
+\endif
+
+-- multibyte identifiers are not broken by search of bind variables
+do $$
+declare
+  c int;
+  r int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'select :a + :kůň + x$ž as "výsledek"'
+                         '  from (select 1 as x$ž) žluťoučký_kůň');
+  call dbms_sql.bind_variable(c, 'a', 10);
+  call dbms_sql.bind_variable(c, 'Kůň', 100);
+  call dbms_sql.define_column(c, 1, r);
+  perform dbms_sql.execute(c);
+  perform dbms_sql.fetch_rows(c);
+  call dbms_sql.column_value(c, 1, r);
+  raise notice 'r: %', r;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
@@ -1,4 +1,6 @@
 \set ECHO none
 set client_min_messages TO error;
-CREATE EXTENSION IF NOT EXISTS dbms_sql;
+-- the tests use extension installed by upgrade script
+CREATE EXTENSION IF NOT EXISTS dbms_sql VERSION '1.0';
+ALTER EXTENSION dbms_sql UPDATE;
 set client_min_messages TO default;
\ No newline at end of file
@@ -0,0 +1,42 @@
+-- this test requires the library loaded by shared_preload_libraries,
+-- it is executed by "make check-statements"
+set client_min_messages TO error;
+CREATE EXTENSION IF NOT EXISTS dbms_sql;
+set client_min_messages TO default;
+
+create table st_foo(a int);
+
+select dbms_sql.statements_reset() is not null as reset;
+
+do $$
+declare
+  c int;
+  a int;
+begin
+  c := dbms_sql.open_cursor();
+  call dbms_sql.parse(c, 'insert into st_foo values(:a)');
+  call dbms_sql.bind_array(c, 'a', array[1, 2, 3]);
+  perform dbms_sql.execute(c);
+  call dbms_sql.bind_array(c, 'a', array[4, 5]);
+  perform dbms_sql.execute(c);
+  call dbms_sql.parse(c, 'select a from st_foo where a > :a');
+  call dbms_sql.bind_variable(c, 'a', 0);
+  call dbms_sql.define_column(c, 1, a);
+  perform dbms_sql.execute(c);
+  while dbms_sql.fetch_rows(c) > 0
+  loop
+    call dbms_sql.column_value(c, 1, a);
+  end loop;
+  call dbms_sql.close_cursor(c);
+end;
+$$;
+
+select calls, rows_processed, bind_array_rows, max_bind_array_size, query
+  from dbms_sql.statements where query like 'insert%';
+select calls, fetch_calls > 0 as fetched, fetched_rows, query
+  from dbms_sql.statements where query like 'select%';
+
+select dbms_sql.statements_reset() is not null as reset;
+select count(*) from dbms_sql.statements;
+
+drop table st_foo;